@@ -0,0 +1,595 @@
+/*
+	ADDR2SYM.C
+
+	Based on SYMVAL.C by Mike Fulton and Eric Smith
+
+	This program should take a file name with or without extension,
+	read in the .ABS or .COF, and print the symbol each of the given
+	addresses falls in, as symbol+offset.
+*/
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+#include "size.h"
+#include "proto.h"
+
+#include <inttypes.h>
+#include <ctype.h>
+#include <stddef.h>
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+#define DEBUG	(0)
+
+#define MAJOR_VERSION (1)
+#define MINOR_VERSION (0)
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+char **address_list;			/* addresses to look up, 1 per line */
+FILE *address_file = NULL;		/* set while reading addresses from stdin */
+short filter_mode = 0;			/* -t: rewrite the addresses in stdin */
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Return the next address to look up, or NULL when there are no more. */
+/* Addresses come from the command line, except that "-" reads them from */
+/* stdin, one per line. */
+
+char *next_address( void )
+{
+static char line[256];
+char *start, *end;
+
+	for (;;)
+	{
+		if (address_file)
+		{
+			if (!fgets(line, sizeof(line), address_file))
+			{
+				address_file = NULL;
+				continue;
+			}
+
+			for (start = line; *start == ' ' || *start == '\t'; start++)
+				;
+			end = start + strlen(start);
+			while (end > start && (end[-1] == '\n' || end[-1] == '\r' ||
+					       end[-1] == ' ' || end[-1] == '\t'))
+				end--;
+			*end = 0;
+
+			if (*start)
+				return start;
+			continue;
+		}
+
+		if (!*address_list)
+			return NULL;
+
+		if (!strcmp(*address_list, "-"))
+		{
+			address_file = stdin;
+			address_list++;
+		}
+		else
+		{
+			return *address_list++;
+		}
+	}
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Look up the addresses in the file open in <obj>.  Returns 0, or -1 */
+/* if something went wrong (which has been reported). */
+
+short process_abs_file( OBJ_FILE *obj )
+{
+	if( obj->kind == OBJ_DRI_ABS || obj->kind == OBJ_DRI_OBJECT )
+	  return print_dri_symbols( obj );
+	return print_coff_symbols( obj );
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Print the symbol containing the address in <arg>, which is in hex with */
+/* or without a leading "0x" or "$". */
+
+/* An address in hex, with at least <digits> digits.  It came from strtoul(), */
+/* so on some systems it can be wider than 32 bits. */
+
+static void print_hex( unsigned long value, int digits )
+{
+	if( value > 0xffffffffUL )
+	{
+		out_hex( (uint32_t)( value >> 16 >> 16 ), digits > 8 ? digits - 8 : 1 );
+		digits = 8;
+	}
+	out_hex( (uint32_t)value, digits );
+}
+
+void print_address( const char *arg, const SYM_ADDR *index, SYM_NAME_FN name_fn, const void *table )
+{
+const SYM_ADDR_ENTRY *entry;
+const char *name;
+char *end;
+unsigned long addr;
+size_t len;
+
+	if (*arg == '$')
+		arg++;
+
+	addr = strtoul(arg, &end, 16);
+	if (end == arg || *end)
+	{
+		out_str(arg);
+		out_str(": not an address");
+		out_eol();
+		return;
+	}
+
+	print_hex(addr, 8);
+	out_bytes(" ", 1);
+
+	entry = sym_addr_find(index, (uint32_t)addr);
+	if (!entry)
+	{
+		out_bytes("??", 2);
+		out_eol();
+		return;
+	}
+
+	name = name_fn(table, entry->sym, &len);
+	out_bytes(name, len);
+	if (addr != entry->value)
+	{
+		out_bytes("+0x", 3);
+		print_hex(addr - (unsigned long)entry->value, 1);
+	}
+	out_eol();
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Filter mode: copy text from a stream to stdout, rewriting each address */
+/* in it as symbol+offset.  Addresses are hex numbers standing on their */
+/* own, either with a 0x or $ in front of them, or 6 to 8 digits long */
+/* with at least one 0-9 among them. */
+/* This is meant for emulator traces that run to gigabytes, so the input */
+/* is read and the output written a megabyte at a time, and the addresses */
+/* are gathered up and looked up in batches. */
+
+#define TRACE_BUF_SIZE		(1024L * 1024L)
+#define TRACE_MAX_ADDRS		(4096)
+
+static signed char hex_value[256];
+
+/* Per batch of addresses found in the input */
+
+static const char *trace_start[TRACE_MAX_ADDRS], *trace_end[TRACE_MAX_ADDRS];
+static uint32_t trace_addr[TRACE_MAX_ADDRS], trace_pending[TRACE_MAX_ADDRS];
+static uint32_t trace_lookup[TRACE_MAX_ADDRS];
+static const SYM_ADDR_ENTRY *trace_found[TRACE_MAX_ADDRS];
+static const SYM_ADDR_ENTRY *trace_batch[TRACE_MAX_ADDRS];
+static const SYM_ADDR_ENTRY *trace_last;
+
+#define IS_WORD(c)	(isalnum((uint8_t)(c)) || (c) == '_')
+
+/* Write symbol+offset for <addr>, which lies in <entry>'s symbol. */
+
+static void trace_symbol( const SYM_ADDR_ENTRY *entry, uint32_t addr, SYM_NAME_FN name_fn, const void *table )
+{
+const char *name;
+size_t len;
+
+	name = name_fn( table, entry->sym, &len );
+	out_bytes( name, len );
+
+	if( addr != entry->value )
+	{
+		out_bytes( "+0x", 3 );
+		out_hex( addr - entry->value, 1 );
+	}
+}
+
+/* Rewrite the addresses in buf[0..len-1], which ends at the end of a line. */
+
+static void trace_chunk( const char *buf, size_t len, const SYM_ADDR *index, SYM_NAME_FN name_fn, const void *table )
+{
+const char *ptr = buf, *end = buf + len, *copied = buf, *digits, *next;
+const SYM_ADDR_ENTRY *last_entry;
+uint32_t num, pending, i, addr;
+size_t max_digits;
+int numeric;
+
+/* With no symbols there's nothing to put in, and no last entry. */
+
+	if( index->count == 0 )
+	{
+		out_bytes( buf, len );
+		return;
+	}
+	last_entry = index->entries + index->count - 1;
+
+	while( ptr < end )
+	{
+		num = pending = 0;
+
+/* Find the next batch of addresses.  Any that fall in the same symbol */
+/* as the last one looked up are resolved on the spot, which catches */
+/* most of them in an instruction trace. */
+
+		while( ptr < end && num < TRACE_MAX_ADDRS )
+		{
+			if( *ptr == '$' && ptr + 1 < end && hex_value[(uint8_t)ptr[1]] >= 0 )
+			{
+				digits = ptr + 1;
+				max_digits = 1;
+			}
+			else if( !IS_WORD( *ptr ) )
+			{
+				ptr++;
+				continue;
+			}
+			else if( *ptr == '0' && ptr + 1 < end && ( ptr[1] == 'x' || ptr[1] == 'X' ) )
+			{
+				digits = ptr + 2;
+				max_digits = 1;
+			}
+			else
+			{
+				digits = ptr;
+				max_digits = 6;
+			}
+
+			addr = 0;
+			numeric = 0;
+			for( next = digits; next < end && hex_value[(uint8_t)*next] >= 0; next++ )
+			{
+				addr = ( addr << 4 ) | hex_value[(uint8_t)*next];
+				numeric |= ( *next <= '9' );
+			}
+
+/* Skip anything that runs on into letters, or is the wrong length, or */
+/* (without a prefix) is a word like "facade" that has no digits in it. */
+
+			if( ( next < end && IS_WORD( *next ) ) ||
+			    next - digits < (ptrdiff_t)max_digits || next - digits > 8 ||
+			    ( digits == ptr && ! numeric ) )
+			{
+				while( next < end && IS_WORD( *next ) )
+					next++;
+				ptr = next;
+				continue;
+			}
+
+			trace_start[num] = ptr;
+			trace_end[num] = next;
+			trace_addr[num] = addr;
+
+			if( trace_last && trace_last->value <= addr &&
+			    ( trace_last == last_entry || addr < trace_last[1].value ) )
+			{
+				trace_found[num] = trace_last;
+			}
+			else
+			{
+				trace_found[num] = NULL;
+				trace_pending[pending] = num;
+				trace_lookup[pending++] = addr;
+			}
+
+			num++;
+			ptr = next;
+		}
+
+		sym_addr_find_batch( index, trace_lookup, pending, trace_batch );
+		for( i = 0; i < pending; i++ )
+			trace_found[trace_pending[i]] = trace_batch[i];
+
+/* Copy out the text up to the end of the batch, with the addresses */
+/* replaced.  Addresses below the first symbol are left alone. */
+
+		for( i = 0; i < num; i++ )
+		{
+			out_bytes( copied, trace_start[i] - copied );
+			if( trace_found[i] )
+			{
+				trace_symbol( trace_found[i], trace_addr[i], name_fn, table );
+				trace_last = trace_found[i];
+			}
+			else
+			{
+				out_bytes( trace_start[i], trace_end[i] - trace_start[i] );
+			}
+			copied = trace_end[i];
+		}
+	}
+
+	out_bytes( copied, end - copied );
+}
+
+void symbolize_stream( FILE *fp, const SYM_ADDR *index, SYM_NAME_FN name_fn, const void *table )
+{
+char *buf, *line_end;
+size_t carry, got, len;
+int i;
+
+	for( i = 0; i < 256; i++ )
+		hex_value[i] = -1;
+	for( i = 0; i < 10; i++ )
+		hex_value['0' + i] = i;
+	for( i = 0; i < 6; i++ )
+		hex_value['a' + i] = hex_value['A' + i] = 10 + i;
+
+	buf = malloc( TRACE_BUF_SIZE );
+	if( ! buf )
+	{
+		fprintf( stderr, "Cannot allocate memory for buffers!\n" );
+		exit(-1);
+	}
+	trace_last = NULL;
+
+/* Hand over whole lines at a time, carrying any partial line at the end */
+/* of the buffer over to the next read.  A line too long to fit in the */
+/* buffer is just split where it fills up. */
+
+	carry = 0;
+	for( ;; )
+	{
+		got = fread( buf + carry, 1, TRACE_BUF_SIZE - carry, fp );
+		len = carry + got;
+
+		if( got == 0 )
+		{
+			trace_chunk( buf, len, index, name_fn, table );
+			break;
+		}
+
+		for( line_end = buf + len; line_end > buf && line_end[-1] != '\n'; line_end-- )
+			;
+
+		if( line_end == buf )
+		{
+			if( len < TRACE_BUF_SIZE )
+			{
+				carry = len;
+				continue;
+			}
+			line_end = buf + len;
+		}
+
+		trace_chunk( buf, line_end - buf, index, name_fn, table );
+
+		carry = buf + len - line_end;
+		memmove( buf, line_end, carry );
+	}
+
+	out_flush();
+	free( buf );
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Look up the addresses from the command line, or filter stdin in -t mode. */
+
+void lookup_addresses( const SYM_ADDR *index, SYM_NAME_FN name_fn, const void *table )
+{
+char *curaddr;
+
+	if (filter_mode)
+	{
+		symbolize_stream( stdin, index, name_fn, table );
+		return;
+	}
+
+	for (curaddr = next_address(); curaddr; curaddr = next_address())
+		print_address( curaddr, index, name_fn, table );
+	out_flush();
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+int print_dri_symbols( OBJ_FILE *obj )
+{
+uint32_t sym, count, num_addrs;
+unsigned int type;
+SYM_TABLE table;
+SYM_ADDR_ENTRY *entries;
+SYM_ADDR index;
+
+/* Read the symbols, then index the ones that name an address. */
+/* This sort of assumes your symbol table will fit in available */
+/* memory (MSDOS memory... less than 600K), but this shouldn't be */
+/* a big problem. */
+
+	count = obj_symbol_count( obj );
+	entries = malloc( ( count ? count : 1 ) * sizeof(SYM_ADDR_ENTRY) );
+	if( ! entries || obj_read_symbols( obj, &table ) < 0 )
+	{
+		fprintf( stderr, "Cannot allocate sufficient memory (%" PRId32 " bytes) for buffer!\n", obj->header.ssize );
+		free( entries );
+		return(-1);
+	}
+
+/* Keep defined Text, Data and BSS symbols, but not equates. */
+
+	num_addrs = 0;
+	for( sym = 0; sym < count; sym++ )
+	{
+		type = table.types[sym];
+
+		if( ( type & 0x8000 ) && ( type & 0x0700 ) && !( type & 0x5000 ) )
+		{
+			entries[num_addrs].value = table.values[sym];
+			entries[num_addrs].sym = sym;
+			num_addrs++;
+		}
+	}
+
+	if( sym_addr_build( &index, entries, num_addrs ) < 0 )
+	{
+		fprintf( stderr, "Cannot allocate memory for address index!\n" );
+		sym_table_free( &table );
+		return(-1);
+	}
+
+	lookup_addresses( &index, sym_table_name, &table );
+
+	sym_addr_free( &index );
+	sym_table_free( &table );
+	return(0);
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+int print_coff_symbols( OBJ_FILE *obj )
+{
+uint32_t sym, num_addrs;
+int err;
+SYM_TABLE table;
+SYM_ADDR_ENTRY *entries;
+SYM_ADDR index;
+
+/* Move to the symbol table and read it, along with its string table */
+	
+	if( ( err = obj_read_symbols( obj, &table ) ) < 0 )
+	{
+		obj_perror( stderr, obj, err, obj->name );
+		return(-1);
+	}
+
+	entries = malloc( ( table.count ? table.count : 1 ) * sizeof(SYM_ADDR_ENTRY) );
+	if( ! entries )
+	{
+		fprintf( stderr, "Cannot allocate memory for symbol information!\n" );
+		sym_table_free( &table );
+		return(-1);
+	}
+
+/* Keep the Text, Data and BSS symbols (local or global) for the */
+/* address index. */
+
+	num_addrs = 0;
+	for( sym = 0; sym < table.count; sym++ )
+	{
+		switch( table.types[sym] & ~1 )
+		{
+			case 0x04:	/* Text */
+			case 0x06:	/* Data */
+			case 0x08:	/* BSS */
+				entries[num_addrs].value = table.values[sym];
+				entries[num_addrs].sym = sym;
+				num_addrs++;
+				break;
+		}
+	}
+
+	if( sym_addr_build( &index, entries, num_addrs ) < 0 )
+	{
+		fprintf( stderr, "Cannot allocate memory for address index!\n" );
+		sym_table_free( &table );
+		return(-1);
+	}
+
+	lookup_addresses( &index, sym_table_name, &table );
+
+	sym_addr_free( &index );
+	sym_table_free( &table );
+	return(0);
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+void usage(void)
+{
+	printf( "ADDR2SYM: Version %d.%02d\n\n", MAJOR_VERSION, MINOR_VERSION );
+
+	printf( "Usage:\n\tADDR2SYM filename address...\n");
+	printf( "\tADDR2SYM -t filename\n\n");
+	printf( "\tfilename = the file to search, or \"-\" to read it from stdin\n\n" );
+	printf( "\taddress = a hex address, with or without a leading 0x or $,\n" );
+	printf( "\t          or \"-\" to read addresses from stdin, one per line\n\n" );
+	printf( "\tEach address is printed with the Text, Data, or BSS symbol at\n" );
+	printf( "\tor below it, as symbol+offset.\n\n" );
+	printf( "\t-t = copy stdin to stdout, rewriting every address in it as\n" );
+	printf( "\t     symbol+offset.  Addresses are hex numbers starting with\n" );
+	printf( "\t     0x or $, or 6 to 8 hex digits long with a 0-9 in them.\n\n" );
+	exit(2);
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+void main( int argc, char *argv[] )
+{
+OBJ_FILE obj;
+char *filename;
+int err;
+
+	argv++;			/* skip the program name */
+
+	while (*argv && (*argv)[0] == '-' && (*argv)[1]) {
+		if (!strcmp(*argv, "-t")) {
+			filter_mode = 1;
+			argv++;
+		} else {
+			usage();
+		}
+	}
+
+	if (!argv[0] || ( filter_mode ? argv[1] != NULL : !argv[1] ))
+		usage();
+
+	filename = argv[0];
+	argv ++;
+	address_list = argv;
+
+	if (!strcmp(filename, "-"))
+	{
+		for ( ; *argv; argv++)
+		{
+			if (!strcmp(*argv, "-"))
+				break;
+		}
+		if (filter_mode || *argv)
+		{
+			printf("Can't read both the executable and addresses from stdin\n");
+			exit(-1);
+		}
+	}
+
+	if( ( err = obj_open( &obj, filename ) ) < 0 )
+	{
+		obj_perror( ( err == OBJ_WRONG_TYPE ) ? stderr : stdout, &obj, err, filename );
+		exit( ( err == OBJ_CANT_READ ) ? -1 : 1 );
+	}
+
+	err = process_abs_file( &obj );
+	obj_close( &obj );
+	exit( err );
+}
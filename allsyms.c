@@ -31,17 +31,10 @@
 /**************************************************************************/
 /**************************************************************************/
 
-ABS_HDR theHeader, tmpHeader;
-COF_HDR coff_header;
-RUN_HDR run_header;
-SEC_HDR txt_header, dta_header, bss_header;
-BSD_Object bsd_object;
-BSD_Symbol *coff_symbols;
-
 int show_symbols = 0;
 int skip_duplicates = 1;
-
-char *coff_symbol_name_strings;
+int file_count = 0;
+int out_format = SYM_FORMAT_TEXT;	/* --format=: how the symbols are listed */
 
 /**************************************************************************/
 /**************************************************************************/
@@ -66,132 +59,80 @@ goodsym(const char *s)
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
-/* Returns -1 if a<b, 0 if a=b, or 1 if a>b */
 
-int dri_symbol_name_compare( const void *a, const char *b )
-{
-char HUGE *aa;
-int i;
-	aa = (char HUGE *)a;
-	{
-		for( i = 0; i < 8; i++ )	/* Check byte by byte so it fails faster! */
-		{
-			if( *aa > *b )
-			  return(1);
-			else if( *aa < *b )
-			  return(-1);
+/* List the symbols of the file open in <obj>.  Returns 0, or -1 if */
+/* something went wrong (which has been reported). */
 
-			aa++;
-			b++;
-		}
-	}
-	return 0;
+short process_abs_file( OBJ_FILE *obj )
+{
+	if( obj->kind == OBJ_DRI_ABS || obj->kind == OBJ_DRI_OBJECT )
+	  return print_dri_symbols( obj );
+	return print_coff_symbols( obj );
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-/* Returns -1 if a<b, 0 if a=b, or 1 if a>b */
-
-int coff_symbol_name_compare( const void *a, const char *b )
+int print_dri_symbols( OBJ_FILE *obj )
 {
-BSD_Symbol HUGE *sym1;
-char HUGE *str1;
-long offset;
-int i;
+SYM_TABLE table;
+SYM_WRITER writer;
+uint32_t sym;
+size_t len;
+const char *name;
+char padded[10];
 
-	sym1 = (BSD_Symbol *)a;
+/* Read the symbols, then list them in the order they're in the file. */
 
-	i = 0;
+	if( obj_read_symbols( obj, &table ) < 0 )
 	{
-		offset = sym1->name_offset;
-		str1 = &coff_symbol_name_strings[offset] - 4;
-	
-		i = strcmp(str1, b);
+		printf( "Cannot allocate sufficient memory (%" PRId32 "bytes) for buffer!\n", obj->header.ssize );
+		return(-1);
 	}
-	return(i);
-}
-
-/**************************************************************************/
-/**************************************************************************/
-/**************************************************************************/
-
-/* Read in a BSD/COFF SEC_HDR structure from the file. */
-/* For Jaguar we don't really care about all of the fields, */
-/* but we still have to read them all! */
-
-void read_sec_hdr( int in_handle, SEC_HDR *section )
-{
-	Fread(in_handle, 8L, &section->name);
-
-	section->start_address = readlong(in_handle);
-	section->start_address_2 = readlong(in_handle);
-
-	section->size = readlong(in_handle);
 
-	section->offset = readlong(in_handle);
-	section->relocation_data = readlong(in_handle);
-	section->debug_info = readlong(in_handle);
-	section->num_reloc_entries = readshort(in_handle);
-	section->num_debug_entries = readshort(in_handle);
-	section->flags = readlong(in_handle);
-}
+	if( out_format != SYM_FORMAT_TEXT )
+	  sym_write_begin( &writer, out_format );
 
-/**************************************************************************/
-/**************************************************************************/
-/**************************************************************************/
+	for( sym = 0; sym < table.count; sym++ )
+	{
+		name = sym_table_name( &table, sym, &len );
 
-/* Read the header, determine if the file is BSD/COFF or DRI format, then */
-/* do the appropriate steps to write out the TEXT, DATA, and maybe the */
-/* SYMBOLS file */
+		/* hand it over as it is */
+		if( out_format != SYM_FORMAT_TEXT )
+		{
+			if( goodsym(name) &&
+			    sym_write_symbol( &writer, name, len, table.values[sym], table.types[sym] ) < 0 )
+			{
+				fprintf( stderr, "Cannot allocate memory for symbol names!\n" );
+				sym_table_free( &table );
+				return(-1);
+			}
+		}
 
-short process_abs_file( char *fname, int in_handle )
-{
-char *ptr, original_fname[256];
-
-/* Save a copy of the original filename, then strip off the filename extension. */
-
-	strncpy( original_fname, fname, 256 );
-	if((ptr = strchr(fname,'.')) != NULL)
-	  *ptr=0;
-
-	theHeader.magic = readshort( in_handle );
-	
-/* BSD Objects have a LONG magic number, so move to start, read it, */
-/* then move back to where we started. (At 2 bytes into file). */
-
-	Fseek( 0L, in_handle, 0 );
-	bsd_object.magic = readlong(in_handle);
-	Fseek( 2L, in_handle, 0 );
-
-/* See if the magic number indicates a DRI/Alcyon-format executable or object module file */
-	
-	if( theHeader.magic == 0x601b || theHeader.magic == 0x601a )
-	{			
-		read_dri_header( in_handle );
-		  print_dri_symbols( in_handle );
-		return(1);
-	}
+		/* or print it padded out to 8 characters, followed (as it */
+		/* always has been) by the top byte of its type */
+		else
+		{
+			memcpy( padded, name, len );
+			memset( padded + len, ' ', 8 - len );
+			padded[8] = (char)( table.types[sym] >> 8 );
+			padded[9] = 0;
 
-/* Not DRI-format, so test for BSD/COFF. */
-	
-	else if( theHeader.magic == 0x0150 ||
-		(theHeader.magic == 0x0000 && bsd_object.magic == 0x00000107L) )
-	{
-		read_coff_header( in_handle );
-		  print_coff_symbols( in_handle );
-		return(1);
+			if (goodsym(padded))
+			{
+				out_str( padded );
+				out_bytes( " == $", 5 );
+				out_hex( table.values[sym], 8 );
+				out_eol();
+			}
+		}
 	}
 
-/* Sorry, don't know what it is. */
-
-	else
-	{
-		fprintf(stderr, "Error: Wrong file type.  Magic number = 0x%04x\n", theHeader.magic );
-		Fclose(in_handle);
-		exit(1);
-	}
+	if( out_format != SYM_FORMAT_TEXT )
+	  sym_write_end( &writer );
+	out_flush();
+	sym_table_free( &table );
 	return(0);
 }
 
@@ -199,377 +140,146 @@ char *ptr, original_fname[256];
 /**************************************************************************/
 /**************************************************************************/
 
-void read_dri_header( int in_handle )
+int print_coff_symbols( OBJ_FILE *obj )
 {
-	theHeader.tsize = readlong(in_handle);
-	theHeader.dsize = readlong(in_handle);
-	theHeader.bsize = readlong(in_handle);
-	theHeader.ssize = readlong(in_handle);
+SYM_TABLE table;
+SYM_WRITER writer;
+uint32_t sym;
+size_t len;
+const char *name;
+int err;
 
-	if( theHeader.magic == 0x601b )		/* If it's an executable... */
+/* Read the symbols, along with their string table */
+
+	if( ( err = obj_read_symbols( obj, &table ) ) < 0 )
 	{
-		theHeader.res1 = readlong(in_handle);		/* not used... */
-		theHeader.tbase = readlong(in_handle);
-		theHeader.relocflag = readshort(in_handle);	/* not used... */
-		theHeader.dbase = readlong(in_handle);
-		theHeader.bbase = readlong(in_handle);
+		obj_perror( stderr, obj, err, obj->name );
+		return(-1);
 	}
-}
 
-/**************************************************************************/
-/**************************************************************************/
-/**************************************************************************/
+	if( out_format != SYM_FORMAT_TEXT )
+	  sym_write_begin( &writer, out_format );
 
-void read_coff_header( int in_handle )
-{
-	if( theHeader.magic == 0x0150 )
+	for( sym = 0; sym < table.count; sym++ )
 	{
-		Fseek( 0L, in_handle, 0 );
-
-		coff_header.magic = readshort(in_handle);
-		coff_header.num_sections = readshort(in_handle);
-		coff_header.date = readlong(in_handle);
-		coff_header.sym_offset = readlong(in_handle);
-		coff_header.num_symbols = readlong(in_handle);
-		coff_header.opt_hdr_size = readshort(in_handle);
-		coff_header.flags = readshort(in_handle);
-
-		run_header.magic = readlong(in_handle);
-		run_header.tsize = readlong(in_handle);
-		run_header.dsize = readlong(in_handle);
-		run_header.bsize = readlong(in_handle);
-		run_header.entry = readlong(in_handle);
-		run_header.tbase = readlong(in_handle);
-		run_header.dbase = readlong(in_handle);
-	}
-	else
-	{		
-		Fseek( 0L, in_handle, 0 );
-
-		bsd_object.magic = readlong(in_handle);
-		bsd_object.tsize = readlong(in_handle);
-		bsd_object.dsize = readlong(in_handle);
-		bsd_object.bsize = readlong(in_handle);
-		bsd_object.ssize = readlong(in_handle);
-		bsd_object.entry = readlong(in_handle);
-		bsd_object.trsize = readlong(in_handle);
-		bsd_object.drsize = readlong(in_handle);
-
-		coff_header.num_sections = 3;
-
-		coff_header.sym_offset = PACKED_SIZEOF(BSD_Object);
-		coff_header.sym_offset += bsd_object.tsize;
-		coff_header.sym_offset += bsd_object.dsize;
-		coff_header.sym_offset += bsd_object.trsize;
-		coff_header.sym_offset += bsd_object.drsize;
-		
-		coff_header.num_symbols = bsd_object.ssize / PACKED_SIZEOF(BSD_Symbol);
-		coff_header.opt_hdr_size = 0L;
-		coff_header.flags = 0L;
+		name = sym_table_name( &table, sym, &len );
+		if (goodsym(name) && out_format != SYM_FORMAT_TEXT)
+		{
+			if( sym_write_symbol( &writer, name, len, table.values[sym], table.types[sym] ) < 0 )
+			{
+				fprintf( stderr, "Cannot allocate memory for symbol names!\n" );
+				sym_table_free( &table );
+				return(-1);
+			}
+		}
+		else if (goodsym(name))
+		{
+			out_str( name );
+			out_bytes( " == $", 5 );
+			out_hex( table.values[sym], 4 );
+			out_eol();
+		}
 	}
-	
-	read_sec_hdr(in_handle, &txt_header);
-	read_sec_hdr(in_handle, &dta_header);
-	read_sec_hdr(in_handle, &bss_header);
-
-/* OK, now we've gotta set up the DRI-format ABS header so */
-/* that we can use it to write the RDBJAG script file later. */
-
-	theHeader.tsize = txt_header.size;
-	theHeader.tbase = txt_header.start_address;
 
-	theHeader.dsize = dta_header.size;
-	theHeader.dbase = dta_header.start_address;
-
-	theHeader.bsize = bss_header.size;
-	theHeader.bbase = bss_header.start_address;
-
-	theHeader.ssize = 0;		/* We don't do anything with symbols yet... */
-	theHeader.res1 = 0;		/* not used... */
-	theHeader.relocflag = 0;	/* not used... */
+	if( out_format != SYM_FORMAT_TEXT )
+	  sym_write_end( &writer );
+	out_flush();
+	sym_table_free( &table );
+	return(0);
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-void print_dri_info(void)
+void usage(void)
 {
-#if 0
-	printf( "Text segment size = 0x%08lx bytes\n", theHeader.tsize );
-	printf( "Data segment size = 0x%08lx bytes\n", theHeader.dsize );
-	printf( "BSS Segment size = 0x%08lx bytes\n", theHeader.bsize );
-
-	printf( "Symbol Table size = 0x%08lx bytes\n", theHeader.ssize );
-
-	if( theHeader.magic != 0x601a )		/* If not an OBJECT module */
-	{
-		printf( "Absolute Address for text segment = 0x%08lx\n", theHeader.tbase );
-		printf( "Absolute Address for data segment = 0x%08lx\n", theHeader.dbase );
-		printf( "Absolute Address for BSS segment = 0x%08lx\n\n", theHeader.bbase );
-	}
+	printf( "ALLSYMS: Version %d.%02d\n\n", MAJOR_VERSION, MINOR_VERSION );
 
-#endif
+	printf( "Usage:\n\tALLSYMS [--format=<fmt>] [-P<n>] filename...\n\n");
+	printf( "\tA filename of - reads the file from stdin.\n\n");
+	printf( "\t--format=<fmt> lists the symbols as text (default), jsonl,\n");
+	printf( "\tcsv or bin instead of as equates.\n\n");
+	printf( "\t-P<n> works on <n> of the files at once (default: one per\n");
+	printf( "\tprocessor).  The output comes out in the order they're given.\n\n");
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-void print_coff_info(void)
+/* Open <filename> (trying .cof then .abs after it, if it has no */
+/* extension) and list its symbols. */
+
+static int allsyms_file( char *filename )
 {
-#if 0
-	if( theHeader.magic == 0x0150 )
-	{
-		printf( "Text Segment Size = 0x%08lx\n", run_header.tsize );
-		printf( "Data Segment Size = 0x%08lx\n", run_header.dsize );
-		printf( "BSS Segment Size = 0x%08lx\n", run_header.bsize );
+OBJ_FILE obj;
+int err;
 
-		printf( "Symbol Table contains %ld symbol entries\n", coff_header.num_symbols );
+	if( file_count > 1 && out_format == SYM_FORMAT_TEXT )
+	  printf( "; %s\n", filename );
 
-		printf( "Starting Address for executable = 0x%08lx\n", run_header.entry );
-		printf( "Start of Text Segment = 0x%08lx\n", run_header.tbase );
-		printf( "Start of Data Segment = 0x%08lx\n", run_header.dbase );
-	
-		printf( "Start of BSS Segment = 0x%08lx\n\n", bss_header.start_address );
-	}
-	else
+	if( ( err = obj_open( &obj, filename ) ) < 0 )
 	{
-		printf( "Text Segment Size = 0x%08lx\n", bsd_object.tsize );
-		printf( "Data Segment Size = 0x%08lx\n", bsd_object.dsize );
-		printf( "BSS Segment Size = 0x%08lx\n", bsd_object.bsize );
+		obj_perror( ( err == OBJ_WRONG_TYPE ) ? stderr : stdout, &obj, err, filename );
+		return ( err == OBJ_WRONG_TYPE ) ? 1 : -1;
 	}
-#endif
+
+	err = process_abs_file( &obj );
+	obj_close( &obj );
+	return(err);
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-void print_dri_symbols( int fhand )
+void main( int argc, char *argv[] )
 {
-char HUGE *ptr;
-uint8_t *uptr;
-long longcount, offset;
-void HUGE *symbuf, HUGE *a, HUGE *b;
-char **cursymbol;
-
-/* Read the symbols, print the ones asked for. */
-/* This sort of assumes your symbol table will fit in available */
-/* memory (MSDOS memory... less than 600K), but this shouldn't be */
-/* a big problem. */
-
-	if( theHeader.magic == 0x601b )					/* ABS executable */
-	  offset = PACKED_SIZEOF(ABS_HDR) + theHeader.tsize + theHeader.dsize;
-	else								/* Object Module */
-	  offset = PACKED_SIZEOF(DRI_Object) + theHeader.tsize + theHeader.dsize;
-
-	Fseek( offset, fhand, 0 );
-	symbuf = farmalloc(theHeader.ssize);
-	if( ! symbuf)
-	{
-		printf( "Cannot allocate sufficient memory (%" PRId32 "bytes) for buffer!\n", theHeader.ssize );
-		exit(-1);
-	}
-
-/* Read the symbols one at a time (because doing it in one chunk isn't working right...) */
-
-	ptr = (char *)symbuf;
-	for( longcount = 0; longcount < theHeader.ssize; longcount += 14 )
-	{
-		Fread( fhand, 14L, ptr );
-		ptr += 14;
-	}
-
-	ptr = symbuf;
+int argument, jobs = 0;
 
+	for( argument = 1; argument < argc; argument++ )
 	{
-
-		for (longcount = 0 ; longcount < theHeader.ssize ; longcount += 14)
+		if( ! strncmp( "--format=", argv[argument], 9 ) )
 		{
-			short i;
-
-			a = ptr;
-			uptr = (uint8_t *)ptr;
-
-			/* print this symbol */
+			out_format = sym_format_parse( argv[argument] + 9 );
+			if( out_format < 0 )
 			{
-
-				for( i = 0; i < 8; i++ )
-				{
-					if( ptr[i] == 0 )
-					{
-						for( ; i < 8; i++ )
-						  ptr[i] = ' ';
-					}
-				}
-
-				ptr[9] = 0;
-
-/* print the values byte by byte because it works on any machine... */
-			
-				if (goodsym(ptr))
-				printf( "%s == $%02x%02x%02x%02x\n", (char *)ptr,
-					(unsigned int)uptr[10], (unsigned int)uptr[11],
-					(unsigned int)uptr[12], (unsigned int)uptr[13] );
+				usage();
+				exit(-1);
 			}
-			ptr += 14;
 		}
-	}
-	farfree( symbuf );
-}
-
-/**************************************************************************/
-/**************************************************************************/
-/**************************************************************************/
-
-void print_coff_symbols( int fhand )
-{
-long sym, symsize, stringtable_size, offset;
-char **cursymbol;
-
-/* Calculate the size needed for the symbol table */
-
-	symsize = coff_header.num_symbols * sizeof(BSD_Symbol);
-
-/* Move to the symbol table, allocate memory for it */
-	
-	offset = coff_header.sym_offset;
-	Fseek(offset,fhand,0);
-
-	coff_symbols = (BSD_Symbol *)farmalloc( symsize );
-	if( ! coff_symbols )
-	{
-		fprintf( stderr, "Cannot allocate memory for symbol information!\n" );
-		exit(-1);
-	}
-
-/* Read the symbols in one by one */
-
-	for( sym = 0; sym < coff_header.num_symbols; sym++ )
-	{
-		coff_symbols[sym].name_offset = readlong( fhand );
-		coff_symbols[sym].type = readbyte( fhand );
-		coff_symbols[sym].other = readbyte( fhand );
-		coff_symbols[sym].description = readshort( fhand );
-		coff_symbols[sym].value = readlong( fhand );
-	}
-
-/* Get the size of the string table (the name strings that go with */
-/* the symbols) then allocate some memory and read it in. */
-/* The string table starts with a longword containing the size, so the */
-/* offsets used by the symbols must be adjusted by -4 when you access */
-/* the individual strings. */
-
-	stringtable_size = readlong( fhand );
-	
-	coff_symbol_name_strings = farmalloc( stringtable_size );
-	if( ! coff_symbol_name_strings )
-	{
-		fprintf( stderr, "Cannot allocate memory for symbol information!\n" );
-		exit(-1);
-	}
-
-	Fread( fhand, stringtable_size, coff_symbol_name_strings );
-
-	{
-		char *ptr;
-
-		for( sym = 0; sym < coff_header.num_symbols; sym++ )
+		else if( ! strncmp( "-P", argv[argument], 2 ) )
 		{
-			long offset, value;
-			int type, other, description, show_it;
-	
-			offset = coff_symbols[sym].name_offset;	
-			value = coff_symbols[sym].value;
-			type = (int)coff_symbols[sym].type;
-			other = (int)coff_symbols[sym].other;
-			description = (int)coff_symbols[sym].description;
-
-			ptr = &coff_symbol_name_strings[offset] - 4;
-			if (goodsym(ptr))
-				printf("%s == $%04lx\n", ptr, value);
+			jobs = atoi( argv[argument] + 2 );
+			if( jobs < 1 || jobs > BATCH_MAX_JOBS )
+			{
+				usage();
+				exit(-1);
+			}
 		}
-	}	
-
-	farfree( coff_symbols );
-	farfree( coff_symbol_name_strings );
-}
-
-/**************************************************************************/
-/**************************************************************************/
-/**************************************************************************/
-
-void usage(void)
-{
-	printf( "ALLSYMS: Version %d.%02d\n\n", MAJOR_VERSION, MINOR_VERSION );
-
-	printf( "Usage:\n\tALLSYMS filename\n\n");
-}
-
-/**************************************************************************/
-/**************************************************************************/
-/**************************************************************************/
-
-void main( int argc, char *argv[] )
-{
-int in_handle;
-short has_period;
-char infile[256], *ptr, *filename;
-int argument;
+		else
+			argv[1 + file_count++] = argv[argument];
+	}
 
-	if(argc < 2)
+	if( ! file_count )
 	{
 		usage();
 		exit(-1);
 	}
 
-/* If you don't sort by name (sort by value), then don't skip duplicate symbols. */
+/* Each machine readable listing is a whole file of its own. */
 
-	filename = argv[1];
-	argv += 2;
-
-/*	Look for FILENAME.EXT (exactly as given on commandline), if that's
-	not found, and filename specified has no extension, then look
-	for FILENAME.COF, and FILENAME.ABS, and do it in that order. */
-
-	strncpy( infile, filename, 255 );
-	has_period = (strchr(infile,'.') != NULL) ? 1 : 0;
-
-	in_handle = Fopen( infile, FO_BINARY );
-	if( in_handle < 0 )
+	if( out_format != SYM_FORMAT_TEXT && file_count > 1 )
 	{
-		/* If there's an extension specified in the input filename, */
-		/* then show the FILE NOT FOUND error message and exit. */
-
-		if( has_period )
-		{
-			printf( "Input file '%s' not found!\n", filename );
-			exit(-1);
-		}
-
-		/* No filename extension was originally specified, so let's try .COF first. */
-
-		strcat(infile,".cof");
-
-		in_handle = Fopen( infile, FO_BINARY );
-		if( in_handle < 0 )
-		{
-			/* file.COF not found, so try .ABS extension */
+		fprintf( stderr, "Only one file can be listed with --format=\n" );
+		exit(-1);
+	}
 
-			if((ptr = strchr(infile,'.')) != NULL)
-			  *ptr=0;
-			strcat(infile,".abs");
+	if( file_count == 1 )
+	  exit( allsyms_file( argv[1] ) );
 
-			if((in_handle = Fopen( infile, FO_BINARY )) < 0)
-			{
-				printf("Error: Can't open inputfile: %s\n",filename);
-				exit(-1);
-			}
-		}
-	}
-	process_abs_file(infile, in_handle);
-	Fclose(in_handle);
-	exit(0);
+	if( ! jobs )
+	  jobs = batch_jobs_default();
+	exit( batch_run( file_count, argv + 1, jobs, allsyms_file ) ? 1 : 0 );
 }
-
@@ -0,0 +1,188 @@
+/*
+	batch.c
+
+	Runs a tool over a list of files.  Each tool's function for a file
+	reports its own errors and returns a status, but it writes straight
+	to stdout and stderr with printf() and the buffered out_*()
+	calls, so rather than threads each file gets a process of its own,
+	and its output can be caught whole without passing a stream down
+	through every function.  Up to <jobs> of them are forked at a time,
+	each with its stdout and stderr sent to temporary files, and as
+	they finish their output is copied out in the order the files were
+	given.  The result is the same however many run at once, and a file
+	that fails, or even crashes, doesn't stop the others.
+
+	Without fork() the files are done one after another in this
+	process, which gives the same output, with the one difference that
+	a crash ends the run.
+*/
+
+#include "size.h"
+#include "proto.h"
+
+#if !defined(_WIN32) && !__MSDOS__
+#define BATCH_FORK
+#include <sys/wait.h>
+#endif
+
+#define BATCH_WINDOW	(4)	/* Files started per job ahead of the output */
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* The number of jobs to run when none is asked for: one per processor. */
+
+int batch_jobs_default( void )
+{
+#if defined(BATCH_FORK) && defined(_SC_NPROCESSORS_ONLN)
+long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+
+	if ( cpus > BATCH_MAX_JOBS )
+		return BATCH_MAX_JOBS;
+	if ( cpus > 1 )
+		return (int)cpus;
+#endif
+	return 1;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+#ifdef BATCH_FORK
+
+typedef struct
+{
+	pid_t	pid;
+	FILE	*out, *err;		/* What it wrote to stdout and stderr */
+	int	status;
+	short	done;
+} BATCH_FILE;
+
+/* Copy everything in <file> to <fhand>, and close it. */
+
+static void batch_copy( FILE *file, int fhand )
+{
+char buf[16384];
+long len, written, pos;
+
+	Fseek( 0L, fileno( file ), SEEK_SET );
+	while ( ( len = Fread( fileno( file ), sizeof(buf), buf ) ) > 0 )
+	{
+		for ( pos = 0; pos < len; pos += written )
+		{
+			written = Fwrite( fhand, len - pos, buf + pos );
+			if ( written <= 0 )
+			{
+				fprintf( stderr, "Error writing output!\n" );
+				exit(-1);
+			}
+		}
+	}
+	fclose( file );
+}
+
+#endif /* BATCH_FORK */
+
+/* Run <fn> on each of the <count> files in <names>, <jobs> at a time. */
+/* Returns the number of them that failed. */
+
+int batch_run( int count, char **names, int jobs, BATCH_FN fn )
+{
+int failed = 0;
+#ifdef BATCH_FORK
+BATCH_FILE *files;
+int next = 0, running = 0, shown = 0, file, status;
+pid_t pid;
+
+/* Anything already printed goes out before the children start, */
+/* or they'd each print it again. */
+
+	out_flush();
+	fflush( stdout );
+	fflush( stderr );
+
+	files = calloc( count ? count : 1, sizeof(BATCH_FILE) );
+	if ( !files )
+	{
+		fprintf( stderr, "Cannot allocate memory for the file list!\n" );
+		exit(-1);
+	}
+
+	while ( shown < count )
+	{
+		while ( next < count && running < jobs && next - shown < jobs * BATCH_WINDOW )
+		{
+			files[next].out = tmpfile();
+			files[next].err = tmpfile();
+			if ( !files[next].out || !files[next].err )
+			{
+				fprintf( stderr, "Cannot create a temporary file!\n" );
+				exit(-1);
+			}
+
+			pid = fork();
+			if ( pid < 0 )
+			{
+				fprintf( stderr, "Cannot start a process for %s!\n", names[next] );
+				exit(-1);
+			}
+			if ( pid == 0 )
+			{
+				dup2( fileno( files[next].out ), 1 );
+				dup2( fileno( files[next].err ), 2 );
+				exit( fn( names[next] ) );
+			}
+
+			files[next].pid = pid;
+			running++;
+			next++;
+		}
+
+		pid = wait( &status );
+		if ( pid < 0 )
+		{
+			fprintf( stderr, "Lost track of the processes!\n" );
+			exit(-1);
+		}
+
+		for ( file = shown; file < next; file++ )
+		{
+			if ( files[file].pid == pid )
+			{
+				files[file].status = status;
+				files[file].done = 1;
+				running--;
+				break;
+			}
+		}
+
+/* Pass on the output of every file that's finished, up to the first */
+/* one that hasn't. */
+
+		for ( ; shown < next && files[shown].done; shown++ )
+		{
+			batch_copy( files[shown].out, 1 );
+			batch_copy( files[shown].err, 2 );
+
+			status = files[shown].status;
+			if ( !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 )
+				failed++;
+		}
+	}
+
+	free( files );
+#else
+int file;
+
+	(void)jobs;
+	for ( file = 0; file < count; file++ )
+	{
+		if ( fn( names[file] ) != 0 )
+			failed++;
+		out_flush();		/* before the next file's printf()s */
+	}
+#endif
+	return failed;
+}
@@ -41,13 +41,6 @@
 /**************************************************************************/
 /**************************************************************************/
 
-ABS_HDR theHeader, tmpHeader;
-COF_HDR coff_header;
-RUN_HDR run_header;
-SEC_HDR txt_header, dta_header, bss_header;
-BSD_Object bsd_object;
-BSD_Symbol *coff_symbols;
-
 static short quiet = 0;
 static short use_fread = 0;
 static short rom_db_script = 0;
@@ -55,179 +48,63 @@ static short no_header = 0;
 static size_t align_size = 0;
 static uint8_t pad_byte = 0xff;
 static const char *romfile = NULL;
-
-char *coff_symbol_name_strings;
-
-static uint32_t dri_symbol_value( const void *s )
-{
-	const uint8_t *uptr = s;
-	uptr += 10;
-
-	return ((uint32_t)uptr[0] << 24) |
-		((uint32_t)uptr[1] << 16) |
-		((uint32_t)uptr[2] << 8) |
-		(uint32_t)uptr[3];
-}
+static const char *outname = NULL;
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
-/* Returns -1 if a<b, 0 if a=b, or 1 if a>b */
 
-int dri_symbol_compare( const void *a, const void *b )
-{
-char HUGE *aa, HUGE *bb;
-int i;
-uint32_t sym_a_val, sym_b_val;
-
-	aa = (char HUGE *)a;
-	bb = (char HUGE *)b;
-	
-	for( i = 0; i < 8; i++ )	/* Check byte by byte so it fails faster! */
-	{
-		if( *aa > *bb )
-			return(1);
-		else if( *aa < *bb )
-			return(-1);
-
-		aa++;
-		bb++;
-	}
+/* Check the file is one we can fix, then do the appropriate steps to */
+/* write out the TEXT, DATA, and maybe the SYMBOLS file, named after */
+/* <fname>.  Returns 0, 1 if it's the wrong kind of file, or -1 if */
+/* something else went wrong (which has been reported). */
 
-/* If sorting by name, but they are the same, then check value. */
-/* Or if we are sorting by value instead... */
-
-	sym_a_val = dri_symbol_value(a);
-	sym_b_val = dri_symbol_value(b);
-	
-	if( sym_a_val > sym_b_val )
-	  return(1);
-	else if( sym_a_val < sym_b_val )
-	  return(-1);
-	else
-	  return(0);
-}
-
-/**************************************************************************/
-/**************************************************************************/
-/**************************************************************************/
-
-/* Returns -1 if a<b, 0 if a=b, or 1 if a>b */
-
-int coff_symbol_compare( const void *a, const void *b )
+short fix_abs_file( OBJ_FILE *obj, const char *fname )
 {
-BSD_Symbol HUGE *sym1, HUGE *sym2;
-int32_t offset;
-char HUGE *str1, HUGE *str2;
-int i;
-
-	sym1 = (BSD_Symbol *)a;
-	sym2 = (BSD_Symbol *)b;
+const ABS_HDR *header = &obj->header;
+char base_fname[260], *ptr;
 
-	i = 0;
-	offset = sym1->name_offset;
-	str1 = &coff_symbol_name_strings[offset] - 4;
-	offset = sym2->name_offset;
-	str2 = &coff_symbol_name_strings[offset] - 4;
+/* Strip off the filename extension to get what the output files are called. */
 
-	i = strcmp(str1, str2);
-
-	if (i) return i;
-
-	if( sym1->value > sym2->value ) return 1;
-	else if( sym1->value < sym2->value ) return -1;
-	else return 0;
-}
-
-/**************************************************************************/
-/**************************************************************************/
-/**************************************************************************/
-
-/* Read in a BSD/COFF SEC_HDR structure from the file. */
-/* For Jaguar we don't really care about all of the fields, */
-/* but we still have to read them all! */
-
-void read_sec_hdr( int in_handle, SEC_HDR *section )
-{
-	Fread(in_handle, 8L, &section->name);
-
-	section->start_address = readlong(in_handle);
-	section->start_address_2 = readlong(in_handle);
-
-	section->size = readlong(in_handle);
-
-	section->offset = readlong(in_handle);
-	section->relocation_data = readlong(in_handle);
-	section->debug_info = readlong(in_handle);
-	section->num_reloc_entries = readshort(in_handle);
-	section->num_debug_entries = readshort(in_handle);
-	section->flags = readlong(in_handle);
-}
-
-/**************************************************************************/
-/**************************************************************************/
-/**************************************************************************/
-
-/* Read the header, determine if the file is BSD/COFF or DRI format, then */
-/* do the appropriate steps to write out the TEXT, DATA, and maybe the */
-/* SYMBOLS file */
-
-short process_abs_file( char *fname, int in_handle )
-{
-char *ptr, original_fname[260];
-
-/* Save a copy of the original filename, then strip off the filename extension. */
-
-	strncpy( original_fname, fname, 255 );
-	if((ptr = strchr(fname,'.')) != NULL)
+	strncpy( base_fname, fname, 255 );
+	base_fname[255] = '\0';
+	if((ptr = strchr(base_fname,'.')) != NULL)
 	  *ptr=0;
 
-	theHeader.magic = readshort( in_handle );
-	
-/* BSD Objects have a LONG magic number, so move to start, read it, */
-/* then move back to where we started. (At 2 bytes into file). */
-
-	Fseek( 0L, in_handle, 0 );
-	bsd_object.magic = readlong(in_handle);
-	Fseek( 2L, in_handle, 0 );
+/* Only DRI/Alcyon-format and BSD/COFF executables will do. */
 
-/* See if the magic number indicates a DRI/Alcyon-format executable or object module file */
-	
-	if( theHeader.magic == 0x601b )
-	{			
-		read_dri_header( in_handle );
+	if( obj->kind == OBJ_DRI_ABS )
+	{
 		if ( !quiet )
-		  print_dri_info();
+		{
+			printf("DRI-format file detected...\n");
+			print_dri_info( obj );
+		}
 	}
-
-/* Not DRI-format, so test for BSD/COFF. */
-	
-	else if( theHeader.magic == 0x0150 )
+	else if( obj->kind == OBJ_COFF )
 	{
-		read_coff_header( in_handle );
 		if ( !quiet )
-		  print_coff_info();
+		  printf("BSD/COFF format file detected...\n");
+		print_coff_header( obj );
+		if ( !quiet )
+		  print_coff_info( obj );
 	}
-
-/* Sorry, don't know what it is. */
-
 	else
 	{
-		printf("Error: Wrong file type.  Magic number = 0x%04x\n", theHeader.magic );
-		Fclose(in_handle);
-		exit(1);
+		printf("Error: Wrong file type.  Magic number = 0x%04x\n", header->magic );
+		return(1);
 	}
 
 	if ( romfile )
 	{
-		if ( ( theHeader.tbase < ROM_START ) ||
-		     ( theHeader.tbase >= ROM_END ) )
+		if ( ( header->tbase < ROM_START ) ||
+		     ( header->tbase >= ROM_END ) )
 		{
 			printf("This program does not execute from ROM space.\n"
 			       "The ROM image file created may not be usable, but we\n"
 			       "will create it anyway!\n\n");
 		}
-		else if ( theHeader.tbase != ROM_START )
+		else if ( header->tbase != ROM_START )
 		{
 			/* ... we will will create it ... [sic] */
 			printf("This program does not start at the proper address of 0x%x\n"
@@ -235,56 +112,79 @@ char *ptr, original_fname[260];
 			       "will create it anyway!\n\n", ROM_START);
 		}
 
-		write_rom_file( in_handle );
+		if ( write_rom_file( obj ) < 0 )
+		  return(-1);
 		if ( rom_db_script )
 		{
-			write_rom_script();
+			return write_rom_script( obj );
 		}
 	}
 	else
 	{
-/* Write out the data section file */
+/* Report the empty sections in the usual order first, then write out */
+/* the others in the order they sit in the input, so it is read once */
+/* from front to back and can just as well be a pipe. */
 
-		if ( theHeader.dsize > 0 )
-		{
-			write_sec_file( fname, in_handle, SEC_DATA );
-		}
-		else if ( !quiet )
+		if ( header->dsize == 0 && !quiet )
 		{
 			printf("Data Segment empty, no DTA file written.\n");
 		}
 
-/* Write out the text section file */
+		if ( header->tsize == 0 && !quiet )
+		{
+			printf("Text Segment empty, no TX file written.\n");
+		}
 
-		if ( theHeader.tsize > 0 )
+		if ( header->dsize > 0 && header->tsize > 0 &&
+		     section_offset( obj, SEC_DATA ) < section_offset( obj, SEC_TEXT ) )
 		{
-			write_sec_file( fname, in_handle, SEC_TEXT );
+			if ( write_sec_file( obj, base_fname, SEC_DATA ) < 0 ||
+			     write_sec_file( obj, base_fname, SEC_TEXT ) < 0 )
+			  return(-1);
 		}
-		else if ( !quiet )
+		else
 		{
-			printf("Text Segment empty, no TX file written.\n");
+			if ( header->tsize > 0 &&
+			     write_sec_file( obj, base_fname, SEC_TEXT ) < 0 )
+			  return(-1);
+
+			if ( header->dsize > 0 &&
+			     write_sec_file( obj, base_fname, SEC_DATA ) < 0 )
+			  return(-1);
 		}
 
-		write_db_file( fname, in_handle );
+		if ( write_db_file( obj, base_fname ) < 0 )
+		  return(-1);
 
-		if( theHeader.magic == 0x601b )
+		if( obj->kind == OBJ_DRI_ABS )
 		{
-			write_sym_file( fname, in_handle );
+			return write_sym_file( obj, base_fname );
 		}
 	}
 
-	return(1);
+	return(0);
 }
 
-#define CHUNK_SIZE 256
+#define PAD_CHUNK_SIZE (1024L * 1024L)
+
+/* Where a section starts in the input file. */
+
+off_t section_offset( const OBJ_FILE *obj, short sec_type )
+{
+	if ( obj->kind == OBJ_COFF )
+	{
+		return ( sec_type == SEC_TEXT ) ? obj->txt_header.offset : obj->dta_header.offset;
+	}
+
+	return PACKED_SIZEOF(ABS_HDR) + ( ( sec_type == SEC_TEXT ) ? 0 : obj->header.tsize );
+}
 
-void write_sec_file( const char *base_fname, int in_handle, short sec_type )
+int write_sec_file( OBJ_FILE *obj, const char *base_fname, short sec_type )
 {
 char outfile[260];
 size_t bytes_left;
 off_t offset;
-int out_handle;
-const char is_cof = (theHeader.magic == 0x0150);
+int out_handle, err;
 
 	strncpy(outfile, base_fname, 255);
 	outfile[255] = '\0';
@@ -293,114 +193,121 @@ const char is_cof = (theHeader.magic == 0x0150);
 	{
 	case SEC_TEXT:
 		strcat(outfile, ".tx");
-		if ( is_cof )
-		{
-			offset = txt_header.offset;
-		}
-		else
-		{
-			offset = PACKED_SIZEOF(ABS_HDR);
-		}
-		bytes_left = theHeader.tsize;
+		bytes_left = obj->header.tsize;
 		break;
 
 	case SEC_DATA:
 		strcat(outfile, ".dta");
-		if ( is_cof )
-		{
-			offset = dta_header.offset;
-		}
-		else
-		{
-			offset = PACKED_SIZEOF(ABS_HDR) + theHeader.tsize;
-		}
-		bytes_left = theHeader.dsize;
+		bytes_left = obj->header.dsize;
 		break;
 
 	default:
 		printf("Unknown section type\n");
-		exit(-1);
+		return(-1);
 	}
 
+	offset = section_offset( obj, sec_type );
 	out_handle = Fopen( outfile, FO_WRONLY | FO_CREATE | FO_BINARY );
 
 	if ( out_handle < 0 )
 	{
 		printf( "Can't create %s\n", outfile );
-		exit(-1);
+		return(-1);
 	}
 
-	write_sec( out_handle, in_handle, offset, bytes_left );
+	err = write_sec( out_handle, &obj->in, offset, bytes_left );
 	Fclose( out_handle );
+	return(err);
 }
 
-size_t write_sec( int out_handle, int in_handle, off_t offset, size_t bytes_left )
-{
-uint8_t buf[CHUNK_SIZE];
-size_t count;
-size_t bytes_written = 0;
+/* Copy a section straight from the input file to the output, letting */
+/* the kernel do it where it can. */
 
-	if ( Fseek( offset, in_handle, 0 ) == -1 )
+int write_sec( int out_handle, IN_FILE *in, off_t offset, size_t bytes_left )
+{
+	if ( in_seek( in, offset ) == -1 )
 	{
 		printf( "Could not seek to section in file\n" );
-		exit(-1);
+		return(-1);
 	}
 
-	while ( bytes_left > 0 )
+	switch ( in_copy( in, out_handle, bytes_left ) )
 	{
-		count = (bytes_left > CHUNK_SIZE) ? CHUNK_SIZE : bytes_left;
-
-		if ( Fread( in_handle, count, buf ) != count )
-		{
-			printf( "Can't read section from file\n" );
-			exit(-1);
-		}
+	case IN_COPY_SHORT:
+		printf( "Can't read section from file\n" );
+		return(-1);
 
-		if ( Fwrite( out_handle, count, buf ) != count )
-		{
-
-			printf( "Can't write section to file\n" );
-			exit(-1);
-		}
-
-		bytes_left -= count;
-		bytes_written += count;
+	case IN_COPY_FAILED:
+		printf( "Can't write section to file\n" );
+		return(-1);
 	}
 
-	return bytes_written;
+	return(0);
 }
 
-static size_t pad( int out_handle, size_t cur_offset, size_t target_offset )
-{
-uint8_t buf[CHUNK_SIZE];
-size_t bytes_written = 0;
+/* Pad the output from <*cur_offset> up to <target_offset>, moving */
+/* <*cur_offset> along.  Zero padding just moves the end of the file */
+/* out, which leaves a hole that reads back as zeros without writing */
+/* (or, on most filesystems, storing) anything.  Anything else, or an */
+/* output that can't be extended that way, is written from a buffer */
+/* filled once, a megabyte at a time. */
 
-	memset( buf, pad_byte, CHUNK_SIZE );
+static int pad( int out_handle, size_t *cur_offset, size_t target_offset )
+{
+uint8_t *buf;
+size_t bytes_left, count;
+off_t pos;
+
+	if ( target_offset <= *cur_offset )
+		return 0;
+
+	bytes_left = target_offset - *cur_offset;
+	*cur_offset = target_offset;
+
+	if ( pad_byte == 0x00 &&
+	     ( pos = Fseek( 0, out_handle, SEEK_CUR ) ) >= 0 &&
+#ifdef _WIN32
+	     _chsize_s( out_handle, (__int64)pos + bytes_left ) == 0 &&
+#else
+	     ftruncate( out_handle, pos + (off_t)bytes_left ) == 0 &&
+#endif
+	     Fseek( pos + (off_t)bytes_left, out_handle, SEEK_SET ) >= 0 )
+	{
+		return 0;
+	}
 
-	while ( ( cur_offset + CHUNK_SIZE ) <= target_offset )
+	count = ( bytes_left > PAD_CHUNK_SIZE ) ? PAD_CHUNK_SIZE : bytes_left;
+	buf = malloc( count );
+	if ( !buf )
 	{
-		Fwrite( out_handle, CHUNK_SIZE, buf );
-		cur_offset += CHUNK_SIZE;
-		bytes_written += CHUNK_SIZE;
+		printf( "Cannot allocate memory for padding!\n" );
+		return -1;
 	}
+	memset( buf, pad_byte, count );
 
-	while ( cur_offset < target_offset )
+	while ( bytes_left > 0 )
 	{
-		Fwrite( out_handle, 1, &pad_byte );
-		cur_offset++;
-		bytes_written++;
+		count = ( bytes_left > PAD_CHUNK_SIZE ) ? PAD_CHUNK_SIZE : bytes_left;
+		if ( Fwrite( out_handle, count, buf ) != (long)count )
+		{
+			printf( "Can't write padding to file\n" );
+			free( buf );
+			return -1;
+		}
+		bytes_left -= count;
 	}
 
-	return bytes_written;
+	free( buf );
+	return 0;
 }
 
-static void pad_up( int out_handle, size_t cur_offset)
+static int pad_up( int out_handle, size_t cur_offset)
 {
 size_t target_size;
 const size_t hdr_bytes = no_header ? 0 : ROM_HDR_SIZE;
 
 	if ( !align_size )
-		return;
+		return 0;
 	
 	if ( !quiet )
 	  printf("Wrote %zu bytes to file so far...\n", cur_offset);
@@ -415,10 +322,10 @@ const size_t hdr_bytes = no_header ? 0 : ROM_HDR_SIZE;
 	  printf("Padding end of ROM image file with %zu %s bytes\n",
 		 target_size - cur_offset, pad_byte ? "$FF" : "ZERO" );
 
-	pad( out_handle, cur_offset, target_size );
+	return pad( out_handle, &cur_offset, target_size );
 }
 
-void write_rom_script( void )
+int write_rom_script( const OBJ_FILE *obj )
 {
 char strbuf[256];
 size_t fnamelen;
@@ -457,26 +364,28 @@ int i;
 	if ( out_handle < 0 )
 	{
 		printf( "Can't create %s\n", strbuf );
-		exit(-1);
+		return(-1);
 	}
 
 	sprintf( strbuf, "%s %s %x\n", (use_fread != 0) ? "fread" : "read",
-		 romfile, theHeader.tbase );
+		 romfile, obj->header.tbase );
 	Fwrite( out_handle, strlen(strbuf), strbuf );
-	sprintf( strbuf, "xpc %x\n", theHeader.tbase );
+	sprintf( strbuf, "xpc %x\n", obj->header.tbase );
 	Fwrite( out_handle, strlen(strbuf), strbuf );
 	sprintf( strbuf, "g\n" );
 	Fwrite( out_handle, strlen(strbuf), strbuf );
 
 	Fclose( out_handle );
+	return(0);
 }
 
-void write_rom_file( int in_handle )
+int write_rom_file( OBJ_FILE *obj )
 {
-const char is_cof = (theHeader.magic == 0x0150);
+const ABS_HDR *header = &obj->header;
+const char is_cof = (obj->kind == OBJ_COFF);
 size_t cur_offset = 0;
-size_t sec_offset = is_cof ? txt_header.offset : PACKED_SIZEOF(ABS_HDR);
-int out_handle;
+size_t sec_offset = is_cof ? obj->txt_header.offset : PACKED_SIZEOF(ABS_HDR);
+int out_handle, err;
 
 	if ( !quiet )
 	  printf( "Creating ROM image file: %s\n", romfile );
@@ -486,7 +395,7 @@ int out_handle;
 	if ( out_handle < 0 )
 	{
 		printf( "Can't create %s\n", romfile );
-		exit(-1);
+		return(-1);
 	}
 
 	/*
@@ -495,38 +404,43 @@ int out_handle;
 	 * dbase below as well. However, this code matches what v6.81 does.
 	 */
 
-	cur_offset += write_sec( out_handle, in_handle,
-				 sec_offset, theHeader.tsize );
+	err = write_sec( out_handle, &obj->in, sec_offset, header->tsize );
+	cur_offset += header->tsize;
 
-	if ( theHeader.dsize > 0 )
+	if ( err == 0 && header->dsize > 0 )
 	{
 		if ( is_cof )
 		{
-			sec_offset = dta_header.offset;
+			sec_offset = obj->dta_header.offset;
 		}
 		else
 		{
-			sec_offset = PACKED_SIZEOF(ABS_HDR) + theHeader.tsize;
+			sec_offset = PACKED_SIZEOF(ABS_HDR) + header->tsize;
 		}
 
-		cur_offset += pad( out_handle, cur_offset,
-				   theHeader.dbase - theHeader.tbase );
+		err = pad( out_handle, &cur_offset, header->dbase - header->tbase );
 
-		cur_offset += write_sec( out_handle, in_handle,
-					 sec_offset, theHeader.dsize );
+		if ( err == 0 )
+		{
+			err = write_sec( out_handle, &obj->in, sec_offset, header->dsize );
+			cur_offset += header->dsize;
+		}
 	}
 
-	pad_up( out_handle, cur_offset );
+	if ( err == 0 )
+	  err = pad_up( out_handle, cur_offset );
 
 	Fclose( out_handle );
+	return(err);
 }
 
-void write_db_file( const char *base_fname, int in_handle)
+int write_db_file( const OBJ_FILE *obj, const char *base_fname )
 {
+const ABS_HDR *header = &obj->header;
 char outfile[260];
 char strbuf[277];
 int out_handle;
-const char is_cof = (theHeader.magic == 0x0150);
+const char is_cof = (obj->kind == OBJ_COFF);
 
 	strncpy(outfile, base_fname, 255);
 	outfile[255] = '\0';
@@ -538,7 +452,7 @@ const char is_cof = (theHeader.magic == 0x0150);
 	if ( out_handle < 0 )
 	{
 		printf( "Can't create %s\n", outfile );
-		exit(-1);
+		return(-1);
 	}
 
 	sprintf( strbuf, "#Created with FILEFIX v%d.%d\n", MAJOR_VERSION, MINOR_VERSION );
@@ -547,19 +461,19 @@ const char is_cof = (theHeader.magic == 0x0150);
 	sprintf( strbuf, "gag on\n" );
 	Fwrite( out_handle, strlen(strbuf), strbuf );
 
-	if ( theHeader.tsize > 0 )
+	if ( header->tsize > 0 )
 	{
 		sprintf( strbuf, "%s %s.tx %" PRIx32 "\n",
 			 (use_fread != 0) ? "fread" : "read",
-			 base_fname, theHeader.tbase );
+			 base_fname, header->tbase );
 		Fwrite( out_handle, strlen(strbuf), strbuf );
 	}
 
-	if ( theHeader.dsize > 0 )
+	if ( header->dsize > 0 )
 	{
 		sprintf( strbuf, "%s %s.dta %" PRIx32 "\n",
 			 (use_fread != 0) ? "fread" : "read",
-			 base_fname, theHeader.dbase );
+			 base_fname, header->dbase );
 		Fwrite( out_handle, strlen(strbuf), strbuf );
 	}
 
@@ -578,239 +492,211 @@ const char is_cof = (theHeader.magic == 0x0150);
 	Fwrite( out_handle, strlen(strbuf), strbuf );
 
 	sprintf( strbuf, "echo \"text\t%" PRIx32 "\t%" PRIx32 "\t%" PRIx32 "\"\n",
-		 theHeader.tbase, theHeader.tsize,
-		 (theHeader.tsize > 0) ?
-		 theHeader.tbase + theHeader.tsize - 1 :
-		 theHeader.tbase );
+		 header->tbase, header->tsize,
+		 (header->tsize > 0) ?
+		 header->tbase + header->tsize - 1 :
+		 header->tbase );
 	Fwrite( out_handle, strlen(strbuf), strbuf );
 
 	sprintf( strbuf, "echo \"data\t%" PRIx32 "\t%" PRIx32 "\t%" PRIx32 "\"\n",
-		 theHeader.dbase, theHeader.dsize,
-		 (theHeader.dsize > 0) ?
-		 theHeader.dbase + theHeader.dsize - 1 :
-		 theHeader.dbase );
+		 header->dbase, header->dsize,
+		 (header->dsize > 0) ?
+		 header->dbase + header->dsize - 1 :
+		 header->dbase );
 	Fwrite( out_handle, strlen(strbuf), strbuf );
 
 	sprintf( strbuf, "echo \"bss\t%" PRIx32 "\t%" PRIx32 "\t%" PRIx32 "\"\n",
-		 theHeader.bbase, theHeader.bsize,
-		 theHeader.bbase + theHeader.bsize - 1 );
+		 header->bbase, header->bsize,
+		 header->bbase + header->bsize - 1 );
 	Fwrite( out_handle, strlen(strbuf), strbuf );
 
 	sprintf( strbuf, "xpc %" PRIx32 "\n",
-		 is_cof ? run_header.entry : theHeader.tbase);
+		 is_cof ? obj->run_header.entry : header->tbase);
 	Fwrite( out_handle, strlen(strbuf), strbuf );
 
 	Fclose( out_handle );
+	return(0);
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-void read_dri_header( int in_handle )
-{
-	theHeader.tsize = readlong(in_handle);
-	theHeader.dsize = readlong(in_handle);
-	theHeader.bsize = readlong(in_handle);
-	theHeader.ssize = readlong(in_handle);
-
-	if ( !quiet )
-	  printf("DRI-format file detected...\n");
-	theHeader.res1 = readlong(in_handle);		/* not used... */
-	theHeader.tbase = readlong(in_handle);
-	theHeader.relocflag = readshort(in_handle);	/* not used... */
-	theHeader.dbase = readlong(in_handle);
-	theHeader.bbase = readlong(in_handle);
-}
+/* Lay out a DRI header in the PACKED_SIZEOF(ABS_HDR) bytes at <buf>. */
 
-void write_dri_header( int out_handle, const ABS_HDR *header )
+void put_dri_header( uint8_t *buf, const ABS_HDR *header )
 {
-	writeshort(out_handle, header->magic);
-	writelong(out_handle, header->tsize);
-	writelong(out_handle, header->dsize);
-	writelong(out_handle, header->bsize);
-	writelong(out_handle, header->ssize);
-	writelong(out_handle, header->res1);
-	writelong(out_handle, header->tbase);
-	writeshort(out_handle, header->relocflag);
-	writelong(out_handle, header->dbase);
-	writelong(out_handle, header->bbase);
+	putshort(buf, header->magic);
+	putlong(buf + 2, header->tsize);
+	putlong(buf + 6, header->dsize);
+	putlong(buf + 10, header->bsize);
+	putlong(buf + 14, header->ssize);
+	putlong(buf + 18, header->res1);
+	putlong(buf + 22, header->tbase);
+	putshort(buf + 26, header->relocflag);
+	putlong(buf + 28, header->dbase);
+	putlong(buf + 32, header->bbase);
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-void read_coff_header( int in_handle )
-{
-	if ( !quiet )
-	  printf("BSD/COFF format file detected...\n");
-	Fseek( 0L, in_handle, 0 );
-
-#define READ_PRINT_SHORT(field) do { \
-	coff_header.field = readshort(in_handle); \
-	printf("coff_header." #field " = 0x%04" PRIx16 "\n", \
-	       coff_header.field); \
-} while (0)
-
-#define READ_PRINT_LONG(field) do { \
-	coff_header.field = readlong(in_handle); \
-	printf("coff_header." #field " = 0x%08" PRIx32 "\n", \
-	       coff_header.field); \
-} while (0)
-
-	READ_PRINT_SHORT(magic);
-	READ_PRINT_SHORT(num_sections);
-	READ_PRINT_LONG(date);
-	READ_PRINT_LONG(sym_offset);
-	READ_PRINT_LONG(num_symbols);
-	READ_PRINT_SHORT(opt_hdr_size);
-	READ_PRINT_SHORT(flags);
-
-	run_header.magic = readlong(in_handle);
-	run_header.tsize = readlong(in_handle);
-	run_header.dsize = readlong(in_handle);
-	run_header.bsize = readlong(in_handle);
-	run_header.entry = readlong(in_handle);
-	run_header.tbase = readlong(in_handle);
-	run_header.dbase = readlong(in_handle);
-	
-	read_sec_hdr(in_handle, &txt_header);
-	read_sec_hdr(in_handle, &dta_header);
-	read_sec_hdr(in_handle, &bss_header);
-
-/* OK, now we've gotta set up the DRI-format ABS header so */
-/* that we can use it to write the RDBJAG script file later. */
-
-	theHeader.tsize = txt_header.size;
-	theHeader.tbase = txt_header.start_address;
+/* Show the COFF file header. */
 
-	theHeader.dsize = dta_header.size;
-	theHeader.dbase = dta_header.start_address;
-
-	theHeader.bsize = bss_header.size;
-	theHeader.bbase = bss_header.start_address;
-
-	theHeader.ssize = 0;		/* We don't do anything with symbols yet... */
-	theHeader.res1 = 0;		/* not used... */
-	theHeader.relocflag = 0;	/* not used... */
+void print_coff_header( const OBJ_FILE *obj )
+{
+const COF_HDR *coff_header = &obj->coff_header;
+
+	printf( "coff_header.magic = 0x%04" PRIx16 "\n", coff_header->magic );
+	printf( "coff_header.num_sections = 0x%04" PRIx16 "\n", coff_header->num_sections );
+	printf( "coff_header.date = 0x%08" PRIx32 "\n", coff_header->date );
+	printf( "coff_header.sym_offset = 0x%08" PRIx32 "\n", coff_header->sym_offset );
+	printf( "coff_header.num_symbols = 0x%08" PRIx32 "\n", coff_header->num_symbols );
+	printf( "coff_header.opt_hdr_size = 0x%04" PRIx16 "\n", coff_header->opt_hdr_size );
+	printf( "coff_header.flags = 0x%04" PRIx16 "\n", coff_header->flags );
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-void print_dri_info(void)
+void print_dri_info( const OBJ_FILE *obj )
 {
-	printf( "Text segment size = 0x%08" PRIx32 " bytes\n", theHeader.tsize );
-	printf( "Data segment size = 0x%08" PRIx32 " bytes\n", theHeader.dsize );
-	printf( "BSS Segment size = 0x%08" PRIx32 " bytes\n", theHeader.bsize );
-
-	printf( "Symbol Table size = 0x%08" PRIx32 " bytes\n", theHeader.ssize );
-	printf( "Absolute Address for text segment = 0x%08" PRIx32 "\n", theHeader.tbase );
-	printf( "Absolute Address for data segment = 0x%08" PRIx32 "\n", theHeader.dbase );
-	printf( "Absolute Address for BSS segment = 0x%08" PRIx32 "\n", theHeader.bbase );
+	printf( "Text segment size = 0x%08" PRIx32 " bytes\n", obj->header.tsize );
+	printf( "Data segment size = 0x%08" PRIx32 " bytes\n", obj->header.dsize );
+	printf( "BSS Segment size = 0x%08" PRIx32 " bytes\n", obj->header.bsize );
+
+	printf( "Symbol Table size = 0x%08" PRIx32 " bytes\n", obj->header.ssize );
+	printf( "Absolute Address for text segment = 0x%08" PRIx32 "\n", obj->header.tbase );
+	printf( "Absolute Address for data segment = 0x%08" PRIx32 "\n", obj->header.dbase );
+	printf( "Absolute Address for BSS segment = 0x%08" PRIx32 "\n", obj->header.bbase );
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-void print_coff_info(void)
+void print_coff_info( const OBJ_FILE *obj )
 {
-	printf( "%" PRId16 " sections specified\n", coff_header.num_sections);
-	printf( "Symbol Table offset = %" PRId32 "\n", coff_header.sym_offset );
+	printf( "%" PRId16 " sections specified\n", obj->coff_header.num_sections);
+	printf( "Symbol Table offset = %" PRId32 "\n", obj->coff_header.sym_offset );
 
-	printf( "Symbol Table contains %" PRId32 " symbol entries\n", coff_header.num_symbols );
-	printf( "The additional header size is %" PRId16 " bytes\n", coff_header.opt_hdr_size );
-	printf( "Magic Number for RUN_HDR = 0x%08" PRIx32 "\n", run_header.magic );
+	printf( "Symbol Table contains %" PRId32 " symbol entries\n", obj->coff_header.num_symbols );
+	printf( "The additional header size is %" PRId16 " bytes\n", obj->coff_header.opt_hdr_size );
+	printf( "Magic Number for RUN_HDR = 0x%08" PRIx32 "\n", obj->run_header.magic );
 
-	printf( "Text Segment Size = %" PRId32 "\n", run_header.tsize );
-	printf( "Data Segment Size = %" PRId32 "\n", run_header.dsize );
-	printf( "BSS Segment Size = %" PRId32 "\n", run_header.bsize );
+	printf( "Text Segment Size = %" PRId32 "\n", obj->run_header.tsize );
+	printf( "Data Segment Size = %" PRId32 "\n", obj->run_header.dsize );
+	printf( "BSS Segment Size = %" PRId32 "\n", obj->run_header.bsize );
 
-	printf( "Starting Address for executable = 0x%08" PRIx32 "\n", run_header.entry );
-	printf( "Start of Text Segment = 0x%08" PRIx32 "\n", run_header.tbase );
-	printf( "Start of Data Segment = 0x%08" PRIx32 "\n", run_header.dbase );
+	printf( "Starting Address for executable = 0x%08" PRIx32 "\n", obj->run_header.entry );
+	printf( "Start of Text Segment = 0x%08" PRIx32 "\n", obj->run_header.tbase );
+	printf( "Start of Data Segment = 0x%08" PRIx32 "\n", obj->run_header.dbase );
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-void write_sym_file( const char *base_fname, int fhand )
+/* Whether the symbols' names are all plain 7-bit characters, with */
+/* nothing but zeros after the end of any that are short. */
+
+static int plain_dri_names( const SYM_TABLE *table )
 {
-char HUGE *ptr;
-char HUGE *dptr;
-uint8_t *uptr;
-int32_t longcount, skipped, offset;
-void HUGE *symbuf, HUGE *a, HUGE *b;
-int out_handle;
+const char *name;
+uint32_t sym;
+int i, ended;
+
+	for ( sym = 0; sym < table->count; sym++ )
+	{
+		name = table->pool + table->names[sym];
+		for ( i = 0, ended = 0; i < 8; i++ )
+		{
+			if ( name[i] & 0x80 || ( ended && name[i] ) )
+				return 0;
+			if ( !name[i] )
+				ended = 1;
+		}
+	}
+	return 1;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+int write_sym_file( OBJ_FILE *obj, const char *base_fname )
+{
+ABS_HDR sym_header;
+SYM_TABLE table;
+uint8_t HUGE *buf, HUGE *rec;
+size_t out_len;
+uint8_t *dup;
+uint32_t sym;
+int out_handle, err;
 char outfile[259];
 
 /* Read the symbols, sort them, deduplicate them, and then dump them. */
 /* This sort of assumes your symbol table will fit in available */
 /* memory, but this shouldn't be a big problem. */
 
-	offset = PACKED_SIZEOF(ABS_HDR) + theHeader.tsize + theHeader.dsize;
+	printf( "Reading symbols...\n" );
 
-	Fseek( offset, fhand, 0 );
-	symbuf = farmalloc(theHeader.ssize);
-	if( ! symbuf)
+	if( ( err = obj_read_symbols( obj, &table ) ) < 0 )
 	{
-		printf( "Cannot allocate sufficient memory (%" PRId32 " bytes) for buffer!\n", theHeader.ssize );
-		exit(-1);
+		obj_perror( stdout, obj, err, obj->name );
+		return(-1);
 	}
 
-/* Read the symbols one at a time (because doing it in one chunk isn't working right...) */
-
-	printf( "Reading symbols...\n" );
+	printf( "Read %d symbols from file\n", (int)table.count );
 
-	ptr = (char FAR *)symbuf;
-	for( longcount = 0; longcount < theHeader.ssize; longcount += 14 )
+	printf( "Sorting and eliminating duplicate symbols...\n" );
+	if( sym_sort_table( &table, 1 ) < 0 ||
+	    ( dup = malloc( table.count + 1 ) ) == NULL )
 	{
-		Fread( fhand, 14L, ptr );
-		ptr += 14;
+		printf( "Cannot allocate memory for symbol information!\n" );
+		sym_table_free( &table );
+		return(-1);
 	}
+	sym_mark_table_duplicates( &table, dup );
+	sym_compact_table( &table, dup );
+	free( dup );
 
-	printf( "Read %d symbols from file\n", longcount / 14 );
+	sym_header = obj->header;
+	sym_header.tsize = 0;
+	sym_header.dsize = 0;
+	sym_header.ssize = table.count * PACKED_SIZEOF(DRI_Symbol);
 
-	printf( "Sorting and eliminating duplicate symbols...\n" );
-	my_qsort( symbuf, (int)(theHeader.ssize/14), 14, dri_symbol_compare );
+/* Mark it as sorted for symval, unless a name's bytes would sort */
+/* differently as unsigned, or there's something after its end. */
 
-	dptr = ptr = symbuf;
-	skipped = 0;
-	for (longcount = 0 ; longcount < theHeader.ssize ; longcount += 14)
-	{
-	int show_it;
-	
-		a = ptr;
-		b = (char HUGE *)a + 14;
-		uptr = (uint8_t *)ptr;
+	if ( plain_dri_names( &table ) )
+		sym_header.res1 = DRI_SORTED_SYMS;
+	else if ( sym_header.res1 == DRI_SORTED_SYMS )
+		sym_header.res1 = 0;
 
-		show_it = 1;
-		if( (longcount+14) < theHeader.ssize )
-		{
-			show_it = dri_symbol_compare(a,b);
-			if( ! show_it )
-			  skipped++;
-		}
+/* Put the header and the symbols back together as one block, so the */
+/* whole .sym file goes out in a single write. */
 
-		if( show_it )
-		{
-			if ( dptr != ptr )
-			{
-				memcpy( dptr, ptr, 14 );
-			}
-			dptr += 14;
-		}
-		ptr += 14;
+	out_len = PACKED_SIZEOF(ABS_HDR) + sym_header.ssize;
+	buf = farmalloc( out_len );
+	if( ! buf )
+	{
+		printf( "Cannot allocate sufficient memory (%ld bytes) for buffer!\n", (long)out_len );
+		sym_table_free( &table );
+		return(-1);
 	}
 
-	memcpy(&tmpHeader, &theHeader, sizeof(tmpHeader));
-	tmpHeader.tsize = 0;
-	tmpHeader.dsize = 0;
-	tmpHeader.ssize = longcount - (skipped * PACKED_SIZEOF(DRI_Symbol));
+	put_dri_header( buf, &sym_header );
+	rec = buf + PACKED_SIZEOF(ABS_HDR);
+	for ( sym = 0; sym < table.count; sym++, rec += PACKED_SIZEOF(DRI_Symbol) )
+	{
+		memcpy( rec, table.pool + table.names[sym], 8 );
+		putshort( rec + 8, table.types[sym] );
+		putlong( rec + 10, table.values[sym] );
+	}
+	sym_table_free( &table );
 
 	strncpy(outfile, base_fname, 255);
 	outfile[255] = '\0';
@@ -821,20 +707,21 @@ char outfile[259];
 	if ( out_handle < 0 )
 	{
 		printf( "Can't create %s\n", outfile );
-		exit(-1);
+		farfree( buf );
+		return(-1);
 	}
 
-	write_dri_header( out_handle, &tmpHeader );
-
-	ptr = symbuf;
-	for (longcount = 0 ; longcount < tmpHeader.ssize ; longcount += PACKED_SIZEOF(DRI_Symbol))
+	if ( Fwrite( out_handle, out_len, buf ) != (long)out_len )
 	{
-		Fwrite( out_handle, PACKED_SIZEOF(DRI_Symbol), ptr );
-		ptr += PACKED_SIZEOF(DRI_Symbol);
+		printf( "Can't write %s\n", outfile );
+		Fclose( out_handle );
+		farfree( buf );
+		return(-1);
 	}
 
 	Fclose( out_handle );
-	farfree( symbuf );
+	farfree( buf );
+	return(0);
 }
 
 /**************************************************************************/
@@ -891,7 +778,7 @@ void usage(void)
 	printf( "A filename extension of .COF or.ABS is assumed if none is provided\n" );
 
 	printf( "(i.e. \"FILEFIX testprog\" will look for <testprog>, then <testprog.cof>,\n" );
-	printf( "then <testprog.abs>, before giving up." );
+	printf( "then <testprog.abs>, before giving up.  A <filename> of - reads from stdin.\n\n" );
 	printf( "For Example:\n\n" );
 
 	printf( "\tfilefix program\t<< finds 'program', 'program.cof', or 'program.abs'\n" );
@@ -899,6 +786,8 @@ void usage(void)
 
 	printf( "Option switches are:\n\n" );
 	printf( "-q = Quiet mode, don't print information about executable file.\n\n" );
+	printf( "-o <name> = Name the TX, DTA, SYM and DB files <name>.tx, etc. instead of\n" );
+	printf( "    after the input file (required when reading from stdin)\n\n" );
 	printf( "-r <romfile> = Create ROM image file named <romfile> from executable\n\n" );
 	printf( "-rs <romfile> = Same as -r, except also create DB script to load and run file.\n\n" );
 	printf( "-p = Pad ROM file with $FF bytes to next 2mb boundary\n" );
@@ -912,6 +801,7 @@ void usage(void)
 	printf( "-f = Use 'fread' command in DB script, instead of 'read'\n\n" );
 	printf( "-n = Assume no header: Do not subtract 8k from final size when padding.\n\n" );
 	printf( "    (this must be used along with the -p, -p4, or -pn switch)\n\n" );
+	printf( "-j<n> = Use <n> threads to sort large symbol tables (default 1)\n\n" );
 }
 
 /**************************************************************************/
@@ -920,10 +810,9 @@ void usage(void)
 
 void main( int argc, char *argv[] )
 {
-int in_handle;
-short has_period;
-char infile[260], *ptr, *filename;
-int argument;
+OBJ_FILE obj;
+char *filename;
+int argument, err;
 
 	if(argc < 2)
 	{
@@ -937,7 +826,7 @@ int argument;
 	{
 //		printf( "Processing argument %d: '%s'\n", argument, argv[argument] );
 
-		if( argv[argument][0] != '-' && argv[argument][0] )
+		if( ( argv[argument][0] != '-' || ! argv[argument][1] ) && argv[argument][0] )
 		{
 			filename = argv[argument];
 		}
@@ -957,6 +846,16 @@ int argument;
 			}
 			romfile = argv[argument];
 		}
+		else if( ! strcmp( "-o", argv[argument] ) )
+		{
+			argument++;
+			if (argument >= argc)
+			{
+				usage();
+				exit(-1);
+			}
+			outname = argv[argument];
+		}
 		else if( ! strcmp( "-p", argv[argument] ) )
 		{
 			/* Pad ROM to 2mb boundary */
@@ -991,6 +890,17 @@ int argument;
 		{
 			no_header = 1;
 		}
+		else if( ! strncmp( "-j", argv[argument], 2 ) )
+		{
+		int threads = atoi( argv[argument] + 2 );
+
+			if( threads < 1 || threads > SYM_SORT_MAX_THREADS )
+			{
+				usage();
+				exit(-1);
+			}
+			sym_sort_threads( threads );
+		}
 		else if( strncmp( "-", argv[argument], 1 ) ) /* unrecognized switch */
 		{
 			usage();
@@ -998,47 +908,24 @@ int argument;
 		}
 	}
 
-/*	Look for FILENAME.EXT (exactly as given on commandline), if that's
-	not found, and filename specified has no extension, then look
-	for FILENAME.COF, and FILENAME.ABS, and do it in that order. */
-
-	strncpy( infile, filename, 255 );
-	has_period = (strchr(infile,'.') != NULL) ? 1 : 0;
-
-	in_handle = Fopen( infile, FO_BINARY );
-	if( in_handle < 0 )
+	if( ( err = obj_open( &obj, filename ) ) < 0 )
 	{
-		/* If there's an extension specified in the input filename, */
-		/* then show the FILE NOT FOUND error message and exit. */
-
-		if( has_period )
-		{
-			printf( "Input file '%s' not found!\n", filename );
-			exit(-1);
-		}
-
-		/* No filename extension was originally specified, so let's try .COF first. */
-
-		strcat(infile,".cof");
-
-		in_handle = Fopen( infile, FO_BINARY );
-		if( in_handle < 0 )
-		{
-			/* file.COF not found, so try .ABS extension */
+		obj_perror( stdout, &obj, err, filename );
+		exit( ( err == OBJ_WRONG_TYPE ) ? 1 : -1 );
+	}
 
-			if((ptr = strchr(infile,'.')) != NULL)
-			  *ptr=0;
-			strcat(infile,".abs");
+/* The output files are named after the input file unless -o names them, */
+/* and there's nothing to name them after when it's coming from stdin. */
 
-			if((in_handle = Fopen( infile, FO_BINARY )) < 0)
-			{
-				printf("Error: Can't open inputfile: %s\n",filename);
-				exit(-1);
-			}
-		}
+	if( ! outname && ! romfile && ! strcmp( obj.name, "-" ) )
+	{
+		printf("Error: Use -o <name> to name the output files when reading from stdin\n");
+		obj_close( &obj );
+		exit(-1);
 	}
-	process_abs_file(infile, in_handle);
-	Fclose(in_handle);
-	exit(0);
+
+	err = fix_abs_file( &obj, outname ? outname : obj.name );
+	obj_close( &obj );
+	exit( err );
 }
 
@@ -0,0 +1,430 @@
+/*
+	infile.c
+
+	Input file layer shared by all of the tools.
+
+	Regular files are mapped into memory with mmap() so the header
+	and symbol table parsers can decode straight from the file image
+	without issuing a read() for every byte, word and long.  Anything
+	that can't be mapped (pipes, or systems without mmap) is read
+	through a buffered window instead, using pread() where the input
+	is seekable and plain sequential reads where it isn't.  Every
+	tool reads its input from front to back, so a file name of "-"
+	takes it from standard input, straight out of a pipeline.
+
+	Whole sections can also be copied from the input to an output
+	file without passing through user space at all, where the system
+	has copy_file_range() or sendfile().
+*/
+
+#ifdef __linux__
+#define _GNU_SOURCE		/* for copy_file_range() */
+#endif
+
+#include "size.h"
+#include "proto.h"
+
+#include <errno.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#if defined(__GLIBC__) && ( __GLIBC__ > 2 || ( __GLIBC__ == 2 && __GLIBC_MINOR__ >= 27 ) )
+#define HAVE_COPY_FILE_RANGE
+#endif
+#endif
+
+#define IN_WINDOW_SIZE	(64L * 1024L)
+#define IN_COPY_CHUNK	(1024L * 1024L)
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Set up an input file for reading.  Returns 0 on success, or -1 if the */
+/* buffer for an unmappable file could not be allocated. */
+
+int in_open( IN_FILE *in, int fhand )
+{
+struct stat st;
+
+	memset( in, 0, sizeof(*in) );
+	in->fhand = fhand;
+	in->size = -1;
+
+	if ( fstat( fhand, &st ) == 0 && ( st.st_mode & S_IFMT ) == S_IFREG )
+	{
+		in->size = st.st_size;
+		in->seekable = 1;
+
+#ifndef _WIN32
+		if ( st.st_size > 0 && (off_t)(size_t)st.st_size == st.st_size )
+		{
+		void *map;
+
+			map = mmap( NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fhand, 0 );
+			if ( map != MAP_FAILED )
+			{
+				in->data = map;
+				in->len = (size_t)st.st_size;
+				in->mapped = 1;
+				return 0;
+			}
+		}
+#endif
+	}
+
+/* Can't map it, so fall back to reading it through a window buffer. */
+
+	in->bufsize = IN_WINDOW_SIZE;
+	in->buf = farmalloc( in->bufsize );
+	if ( !in->buf )
+		return -1;
+
+	in->data = in->buf;
+	return 0;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Open the input file named on the command line, where "-" means */
+/* standard input.  Returns the handle, or a negative number if the */
+/* file couldn't be opened. */
+
+int in_open_name( const char *name )
+{
+	if ( strcmp( name, "-" ) )
+		return Fopen( name, FO_BINARY );
+
+#ifdef _WIN32
+	_setmode( 0, _O_BINARY );
+#endif
+	return 0;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+void in_close( IN_FILE *in )
+{
+#ifndef _WIN32
+	if ( in->mapped )
+		munmap( (void *)in->data, in->len );
+#endif
+	if ( in->buf )
+		farfree( in->buf );
+
+	in->data = NULL;
+	in->buf = NULL;
+	in->len = 0;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Read more of the file into the window buffer so that it holds the */
+/* <len> bytes starting at the current position, or as many of them */
+/* as the file has. */
+
+static void in_fill( IN_FILE *in, size_t len )
+{
+size_t keep, want;
+long count;
+
+	if ( in->seekable )
+	{
+/* Start a new window if we've moved outside the current one. */
+
+		if ( in->pos < in->base || in->pos > in->base + (off_t)in->len )
+		{
+			in->base = in->pos;
+			in->len = 0;
+		}
+	}
+	else
+	{
+/* A pipe can only be read forwards, so throw away anything a */
+/* forward seek skipped over. */
+
+		while ( in->pos > in->base + (off_t)in->len )
+		{
+			in->base += in->len;
+			in->len = 0;
+
+			count = Fread( in->fhand, in->bufsize, in->buf );
+			if ( count <= 0 )
+				return;
+			in->len = count;
+		}
+	}
+
+/* Keep the bytes before the current position around while the window */
+/* is small, since callers often back up a few bytes to re-read part of */
+/* a header.  A pipe has no other way to get them back. */
+
+	if ( in->pos > in->base &&
+	     ( in->seekable || in->pos - in->base > (off_t)(in->bufsize / 2) ) )
+	{
+		keep = (size_t)(in->base + (off_t)in->len - in->pos);
+		memmove( in->buf, in->buf + (size_t)(in->pos - in->base), keep );
+		in->base = in->pos;
+		in->len = keep;
+	}
+
+	want = (size_t)(in->pos - in->base) + len;
+	if ( want > in->bufsize )
+	{
+	uint8_t *newbuf;
+	size_t newsize = in->bufsize;
+
+		while ( newsize < want )
+			newsize *= 2;
+
+		newbuf = realloc( in->buf, newsize );
+		if ( !newbuf )
+			return;
+
+		in->buf = newbuf;
+		in->data = newbuf;
+		in->bufsize = newsize;
+	}
+
+/* Read until the window holds everything that was asked for. */
+
+	while ( in->len < want )
+	{
+		if ( in->seekable )
+		{
+#ifdef _WIN32
+			Fseek( in->base + (off_t)in->len, in->fhand, 0 );
+			count = Fread( in->fhand, in->bufsize - in->len, in->buf + in->len );
+#else
+			count = pread( in->fhand, in->buf + in->len, in->bufsize - in->len,
+				       in->base + (off_t)in->len );
+#endif
+		}
+		else
+		{
+			count = Fread( in->fhand, in->bufsize - in->len, in->buf + in->len );
+		}
+
+		if ( count <= 0 )
+			break;
+
+		in->len += count;
+	}
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Return a pointer to the next <len> bytes of the file and advance */
+/* past them, or NULL if the file doesn't have that many bytes left. */
+
+const uint8_t *in_get( IN_FILE *in, size_t len )
+{
+const uint8_t *ptr;
+
+	if ( !in->mapped &&
+	     ( in->pos < in->base || in->pos + (off_t)len > in->base + (off_t)in->len ) )
+	{
+		in_fill( in, len );
+	}
+
+	if ( in->pos < in->base || in->pos + (off_t)len > in->base + (off_t)in->len )
+		return NULL;
+
+	ptr = in->data + (size_t)(in->pos - in->base);
+	in->pos += len;
+	return ptr;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Copy up to <len> bytes into <dest>.  Anything past the end of the */
+/* file is filled with zeros.  Returns the number of bytes actually */
+/* available from the file. */
+
+size_t in_read( IN_FILE *in, size_t len, void *dest )
+{
+const uint8_t *ptr;
+size_t avail;
+
+	if ( ( ptr = in_get( in, len ) ) != NULL )
+	{
+		memcpy( dest, ptr, len );
+		return len;
+	}
+
+/* Short read: take whatever is left in the file. */
+
+	if ( !in->mapped )
+		in_fill( in, len );
+
+	avail = 0;
+	if ( in->pos >= in->base && in->pos < in->base + (off_t)in->len )
+		avail = (size_t)(in->base + (off_t)in->len - in->pos);
+	if ( avail > len )
+		avail = len;
+
+	if ( avail )
+		memcpy( dest, in->data + (size_t)(in->pos - in->base), avail );
+	memset( (uint8_t *)dest + avail, 0, len - avail );
+
+	in->pos += avail;
+	return avail;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Return a pointer to the rest of a mapped file from the current */
+/* position, and how many bytes that is in <*avail>, without moving. */
+/* The bytes stay where they are until the file is closed, so a large */
+/* part of the file can be held on to this way without copying it, and */
+/* without any page of it that's never looked at being read in at all. */
+/* Returns NULL if the file isn't mapped. */
+
+const uint8_t *in_map( IN_FILE *in, size_t *avail )
+{
+	if ( !in->mapped || in->pos > (off_t)in->len )
+		return NULL;
+
+	*avail = in->len - (size_t)in->pos;
+	return in->data + (size_t)in->pos;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Move to an absolute position in the file.  Returns the new position, */
+/* or -1 if the input is a pipe and that part of it is already gone. */
+
+off_t in_seek( IN_FILE *in, off_t offset )
+{
+	if ( offset < 0 )
+		return -1;
+
+	if ( !in->seekable && offset < in->base )
+		return -1;
+
+	in->pos = offset;
+	return offset;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Write everything in <len> bytes of <data> to <out_handle>. */
+
+static int in_write_all( int out_handle, const uint8_t *data, size_t len )
+{
+size_t count;
+long written;
+
+	while ( len > 0 )
+	{
+		count = ( len > IN_COPY_CHUNK * 64 ) ? IN_COPY_CHUNK * 64 : len;
+		written = Fwrite( out_handle, count, data );
+		if ( written <= 0 )
+			return -1;
+
+		data += written;
+		len -= written;
+	}
+	return 0;
+}
+
+/* Copy <len> bytes from the current position to <out_handle>, at its */
+/* current position, and advance past them.  The kernel is asked to do */
+/* the copy itself with copy_file_range(), then sendfile(); if neither */
+/* will (different kinds of files, or an old kernel) the bytes are */
+/* written straight out of the mapped file, or else through the window */
+/* a megabyte at a time.  Returns IN_COPY_OK, IN_COPY_SHORT if the file */
+/* ends first, or IN_COPY_FAILED if the output couldn't be written. */
+
+int in_copy( IN_FILE *in, int out_handle, size_t len )
+{
+const uint8_t *ptr;
+size_t count;
+
+#ifdef __linux__
+	if ( in->seekable )
+	{
+	off_t offset = in->pos;
+	ssize_t copied = -1;
+	int use_sendfile = 0;
+
+		while ( len > 0 )
+		{
+			count = ( len > 0x40000000UL ) ? 0x40000000UL : len;
+#ifdef HAVE_COPY_FILE_RANGE
+			if ( !use_sendfile )
+			{
+				copied = copy_file_range( in->fhand, &offset, out_handle, NULL, count, 0 );
+				if ( copied < 0 && offset == in->pos &&
+				     ( errno == EXDEV || errno == EINVAL || errno == ENOSYS ||
+				       errno == EOPNOTSUPP || errno == EBADF ) )
+				{
+					use_sendfile = 1;
+					continue;
+				}
+			}
+			else
+#endif
+			{
+				copied = sendfile( out_handle, in->fhand, &offset, count );
+			}
+
+			if ( copied <= 0 )
+				break;
+
+			len -= copied;
+			in->pos = offset;
+		}
+
+		if ( len == 0 )
+			return IN_COPY_OK;
+		if ( copied == 0 )
+			return IN_COPY_SHORT;
+
+/* Neither call could be used, or one of them gave up part of the way */
+/* through; do the rest by hand. */
+	}
+#endif
+
+	if ( in->mapped )
+	{
+		if ( in->pos + (off_t)len > (off_t)in->len )
+			return IN_COPY_SHORT;
+
+		ptr = in->data + (size_t)in->pos;
+		in->pos += len;
+		return in_write_all( out_handle, ptr, len ) ? IN_COPY_FAILED : IN_COPY_OK;
+	}
+
+	while ( len > 0 )
+	{
+		count = ( len > IN_COPY_CHUNK ) ? IN_COPY_CHUNK : len;
+		if ( ( ptr = in_get( in, count ) ) == NULL )
+			return IN_COPY_SHORT;
+
+		if ( in_write_all( out_handle, ptr, count ) )
+			return IN_COPY_FAILED;
+		len -= count;
+	}
+	return IN_COPY_OK;
+}
@@ -0,0 +1,332 @@
+/*
+	objfile.c
+
+	Opening and identifying the executables and object files the tools
+	work on.  Everything read from a file's headers goes into the
+	OBJ_FILE it was opened with rather than into globals, and problems
+	are handed back as OBJ_xxx codes instead of ending the program, so
+	any number of files can be open at once, on as many threads, and
+	it's up to the caller what to do about one that can't be used.
+	The rest of the library is the same: symbol tables, indexes and
+	listings are all held in structures the caller passes in.  The
+	exceptions are the output buffer in outbuf.c, which stands for
+	stdout and is only written from one thread, and the thread count
+	set with sym_sort_threads().
+*/
+
+#include "size.h"
+#include "proto.h"
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Read in a BSD/COFF SEC_HDR structure from the file. */
+/* For Jaguar we don't really care about all of the fields, */
+/* but we still have to read them all! */
+
+static void obj_read_sec_hdr( IN_FILE *in, SEC_HDR *section )
+{
+	in_read( in, 8L, &section->name );
+
+	section->start_address = readlong(in);
+	section->start_address_2 = readlong(in);
+
+	section->size = readlong(in);
+
+	section->offset = readlong(in);
+	section->relocation_data = readlong(in);
+	section->debug_info = readlong(in);
+	section->num_reloc_entries = readshort(in);
+	section->num_debug_entries = readshort(in);
+	section->flags = readlong(in);
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+static void obj_read_dri_header( OBJ_FILE *obj )
+{
+IN_FILE *in = &obj->in;
+ABS_HDR *header = &obj->header;
+
+	header->tsize = readlong(in);
+	header->dsize = readlong(in);
+	header->bsize = readlong(in);
+	header->ssize = readlong(in);
+
+	if( header->magic == 0x601b )		/* If it's an executable... */
+	{
+		header->res1 = readlong(in);		/* not used... */
+		header->tbase = readlong(in);
+		header->relocflag = readshort(in);	/* not used... */
+		header->dbase = readlong(in);
+		header->bbase = readlong(in);
+	}
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+static void obj_read_coff_header( OBJ_FILE *obj )
+{
+IN_FILE *in = &obj->in;
+COF_HDR *coff_header = &obj->coff_header;
+
+	in_seek( in, 0L );
+
+	if( obj->kind == OBJ_COFF )
+	{
+	RUN_HDR *run_header = &obj->run_header;
+
+		coff_header->magic = readshort(in);
+		coff_header->num_sections = readshort(in);
+		coff_header->date = readlong(in);
+		coff_header->sym_offset = readlong(in);
+		coff_header->num_symbols = readlong(in);
+		coff_header->opt_hdr_size = readshort(in);
+		coff_header->flags = readshort(in);
+
+		run_header->magic = readlong(in);
+		run_header->tsize = readlong(in);
+		run_header->dsize = readlong(in);
+		run_header->bsize = readlong(in);
+		run_header->entry = readlong(in);
+		run_header->tbase = readlong(in);
+		run_header->dbase = readlong(in);
+	}
+	else
+	{
+	BSD_Object *bsd_object = &obj->bsd_object;
+
+		bsd_object->magic = readlong(in);
+		bsd_object->tsize = readlong(in);
+		bsd_object->dsize = readlong(in);
+		bsd_object->bsize = readlong(in);
+		bsd_object->ssize = readlong(in);
+		bsd_object->entry = readlong(in);
+		bsd_object->trsize = readlong(in);
+		bsd_object->drsize = readlong(in);
+
+		coff_header->num_sections = 3;
+
+		coff_header->sym_offset = PACKED_SIZEOF(BSD_Object);
+		coff_header->sym_offset += bsd_object->tsize;
+		coff_header->sym_offset += bsd_object->dsize;
+		coff_header->sym_offset += bsd_object->trsize;
+		coff_header->sym_offset += bsd_object->drsize;
+
+		coff_header->num_symbols = bsd_object->ssize / PACKED_SIZEOF(BSD_Symbol);
+		coff_header->opt_hdr_size = 0L;
+		coff_header->flags = 0L;
+	}
+
+	obj_read_sec_hdr(in, &obj->txt_header);
+	obj_read_sec_hdr(in, &obj->dta_header);
+	obj_read_sec_hdr(in, &obj->bss_header);
+
+/* OK, now we've gotta set up the DRI-format ABS header so */
+/* that we can use it to write the RDBJAG script file later. */
+
+	obj->header.tsize = obj->txt_header.size;
+	obj->header.tbase = obj->txt_header.start_address;
+
+	obj->header.dsize = obj->dta_header.size;
+	obj->header.dbase = obj->dta_header.start_address;
+
+	obj->header.bsize = obj->bss_header.size;
+	obj->header.bbase = obj->bss_header.start_address;
+
+	obj->header.ssize = 0;		/* We don't do anything with symbols yet... */
+	obj->header.res1 = 0;		/* not used... */
+	obj->header.relocflag = 0;	/* not used... */
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Work out what kind of file it is from the magic number, and read */
+/* its headers. */
+
+static int obj_read_header( OBJ_FILE *obj )
+{
+IN_FILE *in = &obj->in;
+
+	obj->header.magic = readshort(in);
+
+/* BSD Objects have a LONG magic number, so move to start, read it, */
+/* then move back to where we started. (At 2 bytes into file). */
+
+	in_seek( in, 0L );
+	obj->bsd_object.magic = readlong(in);
+	in_seek( in, 2L );
+
+	if( obj->header.magic == 0x601b || obj->header.magic == 0x601a )
+	{
+		obj->kind = ( obj->header.magic == 0x601b ) ? OBJ_DRI_ABS : OBJ_DRI_OBJECT;
+		obj_read_dri_header( obj );
+	}
+	else if( obj->header.magic == 0x0150 ||
+		(obj->header.magic == 0x0000 && obj->bsd_object.magic == 0x00000107L) )
+	{
+		obj->kind = ( obj->header.magic == 0x0150 ) ? OBJ_COFF : OBJ_BSD;
+		obj_read_coff_header( obj );
+	}
+	else
+	{
+		return OBJ_WRONG_TYPE;
+	}
+
+	return OBJ_OK;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Open <filename> and read its headers.  Like the tools always have, */
+/* look for FILENAME.EXT exactly as given, and if that's not found and */
+/* it has no extension, look for FILENAME.COF and then FILENAME.ABS. */
+/* A <filename> of "-" reads the file from stdin. */
+
+int obj_open( OBJ_FILE *obj, const char *filename )
+{
+size_t len;
+int err;
+
+	memset( obj, 0, sizeof(*obj) );
+
+	len = strlen( filename );
+	if( len > sizeof(obj->name) - 5 )
+	  len = sizeof(obj->name) - 5;
+	memcpy( obj->name, filename, len );
+	obj->name[len] = 0;
+
+	obj->fhand = in_open_name( obj->name );
+	if( obj->fhand < 0 )
+	{
+		if( strchr( obj->name, '.' ) )
+		  return OBJ_NOT_FOUND;
+
+		strcpy( obj->name + len, ".cof" );
+		obj->fhand = Fopen( obj->name, FO_BINARY );
+		if( obj->fhand < 0 )
+		{
+			strcpy( obj->name + len, ".abs" );
+			obj->fhand = Fopen( obj->name, FO_BINARY );
+			if( obj->fhand < 0 )
+			  return OBJ_CANT_OPEN;
+		}
+	}
+
+	if( in_open( &obj->in, obj->fhand ) < 0 )
+	{
+		Fclose( obj->fhand );
+		return OBJ_CANT_READ;
+	}
+
+	if( ( err = obj_read_header( obj ) ) < 0 )
+	{
+		obj_close( obj );
+		return err;
+	}
+
+	return OBJ_OK;
+}
+
+void obj_close( OBJ_FILE *obj )
+{
+	in_close( &obj->in );
+	Fclose( obj->fhand );
+	obj->fhand = -1;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Where the symbol table starts, and how many symbols are in it. */
+
+off_t obj_symbol_offset( const OBJ_FILE *obj )
+{
+	switch( obj->kind )
+	{
+	case OBJ_DRI_ABS:
+		return PACKED_SIZEOF(ABS_HDR) + obj->header.tsize + obj->header.dsize;
+	case OBJ_DRI_OBJECT:
+		return PACKED_SIZEOF(DRI_Object) + obj->header.tsize + obj->header.dsize;
+	default:
+		return obj->coff_header.sym_offset;
+	}
+}
+
+uint32_t obj_symbol_count( const OBJ_FILE *obj )
+{
+	if( obj->kind == OBJ_DRI_ABS || obj->kind == OBJ_DRI_OBJECT )
+	  return (uint32_t)obj->header.ssize / PACKED_SIZEOF(DRI_Symbol);
+	return (uint32_t)obj->coff_header.num_symbols;
+}
+
+/* Whether the symbols are in the order filefix writes a .sym file in. */
+/* Other tools may well leave something in res1, so the mark only */
+/* counts in a file that's nothing but symbols, as a .sym file is. */
+
+int obj_dri_sorted( const OBJ_FILE *obj )
+{
+	return obj->kind == OBJ_DRI_ABS && obj->header.res1 == DRI_SORTED_SYMS &&
+	       obj->header.tsize == 0 && obj->header.dsize == 0;
+}
+
+/* Load the symbols into <table>. */
+
+int obj_read_symbols( OBJ_FILE *obj, SYM_TABLE *table )
+{
+int err;
+
+	in_seek( &obj->in, obj_symbol_offset( obj ) );
+
+	if( obj->kind == OBJ_DRI_ABS || obj->kind == OBJ_DRI_OBJECT )
+	  err = sym_table_read_dri( table, &obj->in, obj_symbol_count( obj ) );
+	else
+	  err = sym_table_read_coff( table, &obj->in, obj_symbol_count( obj ) );
+
+	if( err == SYM_TABLE_SHORT )
+	  return OBJ_SHORT;
+	if( err < 0 )
+	  return OBJ_NO_MEMORY;
+	return OBJ_OK;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Print the message that goes with an OBJ_xxx result. */
+
+void obj_perror( FILE *fp, const OBJ_FILE *obj, int err, const char *filename )
+{
+	switch( err )
+	{
+	case OBJ_NOT_FOUND:
+		fprintf( fp, "Input file '%s' not found!\n", filename );
+		break;
+	case OBJ_CANT_OPEN:
+		fprintf( fp, "Error: Can't open inputfile: %s\n", filename );
+		break;
+	case OBJ_CANT_READ:
+		fprintf( fp, "Error: Can't read inputfile: %s\n", filename );
+		break;
+	case OBJ_WRONG_TYPE:
+		fprintf( fp, "Error: Wrong file type.  Magic number = 0x%04x\n", obj->header.magic );
+		break;
+	case OBJ_NO_MEMORY:
+		fprintf( fp, "Cannot allocate memory for symbol information!\n" );
+		break;
+	case OBJ_SHORT:
+		fprintf( fp, "Cannot read symbol information from file!\n" );
+		break;
+	}
+}
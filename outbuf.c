@@ -0,0 +1,204 @@
+/*
+	outbuf.c
+
+	Output layer shared by the tools for their symbol listings.
+
+	Lines are assembled in one large buffer, with the hex and decimal
+	numbers converted through a lookup table and the padding done by
+	copying, and the buffer goes out with a single write() whenever
+	it fills.  A listing of a hundred thousand symbols then costs a
+	handful of system calls instead of a trip through printf() for
+	every field of every symbol.
+
+	Anything printed with stdio is flushed before the buffer is first
+	used, and the buffer is flushed again at exit, so the two can be
+	mixed as long as out_flush() is called before going back to
+	printf().  When stdout is a terminal each line goes out as soon
+	as it's finished, like stdio does.
+*/
+
+#include "size.h"
+#include "proto.h"
+
+#define OUT_BUF_SIZE	(1024L * 1024L)
+
+static char *out_buf;
+static size_t out_len;
+static short out_ready = 0;
+static short out_tty = 0;
+static char hex_pair[256][2];
+
+static const char spaces[] = "                                        ";
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Write <len> bytes straight to stdout.  Returns 0, or -1 on an error. */
+
+static int out_write( const char *data, size_t len )
+{
+long written;
+
+	while ( len > 0 )
+	{
+		written = Fwrite( 1, len, data );
+		if ( written <= 0 )
+			return -1;
+
+		data += written;
+		len -= written;
+	}
+	return 0;
+}
+
+static void out_exit( void )
+{
+	if ( out_len )
+		out_write( out_buf, out_len );
+	out_len = 0;
+}
+
+static void out_setup( void )
+{
+int i;
+
+	for ( i = 0; i < 256; i++ )
+	{
+		hex_pair[i][0] = "0123456789abcdef"[i >> 4];
+		hex_pair[i][1] = "0123456789abcdef"[i & 15];
+	}
+
+	out_buf = malloc( OUT_BUF_SIZE );
+	out_tty = isatty( 1 );
+	atexit( out_exit );
+	out_ready = 1;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Send everything buffered so far to stdout. */
+
+void out_flush( void )
+{
+	if ( out_len && out_write( out_buf, out_len ) < 0 )
+	{
+		out_len = 0;
+		fprintf( stderr, "Error writing output!\n" );
+		exit(-1);
+	}
+	out_len = 0;
+}
+
+void out_bytes( const char *data, size_t len )
+{
+	if ( !out_ready )
+		out_setup();
+
+/* Whatever stdio is holding on to was printed first. */
+
+	if ( out_len == 0 )
+		fflush( stdout );
+
+	if ( len > OUT_BUF_SIZE - out_len || !out_buf )
+	{
+		out_flush();
+		if ( len > OUT_BUF_SIZE || !out_buf )
+		{
+			if ( out_write( data, len ) < 0 )
+			{
+				fprintf( stderr, "Error writing output!\n" );
+				exit(-1);
+			}
+			return;
+		}
+	}
+
+	memcpy( out_buf + out_len, data, len );
+	out_len += len;
+}
+
+void out_str( const char *str )
+{
+	out_bytes( str, strlen( str ) );
+}
+
+/* End the current line. */
+
+void out_eol( void )
+{
+	out_bytes( "\n", 1 );
+	if ( out_tty )
+		out_flush();
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* <str> left justified in a field <width> characters wide, like %-*s. */
+
+void out_pad( const char *str, size_t width )
+{
+size_t len = strlen( str ), pad;
+
+	out_bytes( str, len );
+
+	for ( ; len < width; len += pad )
+	{
+		pad = width - len;
+		if ( pad > sizeof(spaces) - 1 )
+			pad = sizeof(spaces) - 1;
+		out_bytes( spaces, pad );
+	}
+}
+
+/* <value> in lower case hex, with at least <digits> digits, like %0*x. */
+
+void out_hex( uint32_t value, int digits )
+{
+char hex[8];
+int first;
+
+	if ( !out_ready )
+		out_setup();
+
+	memcpy( hex, hex_pair[value >> 24], 2 );
+	memcpy( hex + 2, hex_pair[(value >> 16) & 0xff], 2 );
+	memcpy( hex + 4, hex_pair[(value >> 8) & 0xff], 2 );
+	memcpy( hex + 6, hex_pair[value & 0xff], 2 );
+
+	for ( first = 0; first < 7 && first < 8 - digits && hex[first] == '0'; first++ )
+		;
+	out_bytes( hex + first, 8 - first );
+}
+
+/* <value> in decimal, like %u and %d. */
+
+void out_udec( uint32_t value )
+{
+char dec[12], *ptr = dec + sizeof(dec);
+
+	do
+	{
+		*--ptr = (char)( '0' + value % 10 );
+		value /= 10;
+	} while ( value );
+
+	out_bytes( ptr, dec + sizeof(dec) - ptr );
+}
+
+void out_dec( int32_t value )
+{
+	if ( value < 0 )
+	{
+		out_bytes( "-", 1 );
+		out_udec( 0 - (uint32_t)value );
+	}
+	else
+	{
+		out_udec( (uint32_t)value );
+	}
+}
@@ -11,24 +11,29 @@ int cvt_int_m2i ( int i );
  ****************************************************************************/
 
 void checkpoint ( char *funcname , short ckpoint );
-int dri_symbol_compare ( const void *a , const void *b );
-int coff_symbol_compare ( const void *a , const void *b );
-void read_sec_hdr ( int in_handle , SEC_HDR *section );
-short process_abs_file ( char *fname , int in_handle );
-void read_dri_header ( int in_handle );
-void read_coff_header ( int in_handle );
-void print_dri_info ( void );
-void print_coff_info ( void );
-void print_dri_symbols ( int fhand );
-void print_coff_symbols( int fhand );
-void write_sec_file( const char *base_fname, int in_handle, short section );
-size_t write_sec( int out_handle, int in_handle, off_t offset, size_t bytes_left );
-void write_db_file( const char *base_fname, int in_handle );
-void write_sym_file( const char *base_fname, int fhand );
-void write_rom_file( int in_handle );
-void write_rom_script( void );
+short process_abs_file( OBJ_FILE *obj );
+short fix_abs_file( OBJ_FILE *obj, const char *fname );
+void print_dri_info( const OBJ_FILE *obj );
+void print_coff_info( const OBJ_FILE *obj );
+void print_coff_header( const OBJ_FILE *obj );
+void print_summary( const char *fname, uint32_t tsize, uint32_t dsize, uint32_t bsize );
+int print_dri_symbols( OBJ_FILE *obj );
+int print_coff_symbols( OBJ_FILE *obj );
+void print_cached_symbols( const SYM_CACHE *cache );
+char *next_symbol_name( void );
+char *next_address( void );
+void print_address( const char *arg, const SYM_ADDR *index, SYM_NAME_FN name_fn, const void *table );
+void lookup_addresses( const SYM_ADDR *index, SYM_NAME_FN name_fn, const void *table );
+void symbolize_stream( FILE *fp, const SYM_ADDR *index, SYM_NAME_FN name_fn, const void *table );
+off_t section_offset( const OBJ_FILE *obj, short sec_type );
+int write_sec_file( OBJ_FILE *obj, const char *base_fname, short sec_type );
+int write_sec( int out_handle, IN_FILE *in, off_t offset, size_t bytes_left );
+int write_db_file( const OBJ_FILE *obj, const char *base_fname );
+int write_sym_file( OBJ_FILE *obj, const char *base_fname );
+int write_rom_file( OBJ_FILE *obj );
+int write_rom_script( const OBJ_FILE *obj );
 void show_dri_symbol_type( unsigned int symtype );
-int show_bsd_symbol_type( int32_t value, char *str, int symtype, int other, int description );
+int show_bsd_symbol_type( int32_t value, const char *str, int symtype, int description );
 void usage(void);
 void main ( int argc , char *argv []);
 
@@ -36,9 +41,128 @@ void main ( int argc , char *argv []);
  *	readint.c
  ****************************************************************************/
 
-unsigned char readbyte( int fhand );
-unsigned short readshort ( int fhand );
-unsigned long readlong ( int fhand );
+uint16_t getshort( const uint8_t *ptr );
+uint32_t getlong( const uint8_t *ptr );
+void putshort( uint8_t *ptr, uint16_t val );
+void putlong( uint8_t *ptr, uint32_t val );
+void get_bsd_columns( const uint8_t *data, uint32_t count, uint32_t *names,
+		      uint16_t *types, uint16_t *descs, uint32_t *values );
+void get_dri_columns( const uint8_t *data, uint32_t count, uint16_t *types, uint32_t *values );
+unsigned char readbyte( IN_FILE *in );
+unsigned short readshort ( IN_FILE *in );
+unsigned long readlong ( IN_FILE *in );
 long writelong( int fhand, long lval );
 long writeshort( int fhand, short sval );
 
+/*****************************************************************************
+ *	infile.c
+ ****************************************************************************/
+
+int in_open( IN_FILE *in, int fhand );
+int in_open_name( const char *name );
+void in_close( IN_FILE *in );
+const uint8_t *in_get( IN_FILE *in, size_t len );
+size_t in_read( IN_FILE *in, size_t len, void *dest );
+const uint8_t *in_map( IN_FILE *in, size_t *avail );
+off_t in_seek( IN_FILE *in, off_t offset );
+int in_copy( IN_FILE *in, int out_handle, size_t len );
+
+/*****************************************************************************
+ *	symhash.c
+ ****************************************************************************/
+
+uint32_t sym_hash_string( const char *name, size_t len );
+int sym_hash_build( SYM_HASH *hash, uint32_t count, SYM_NAME_FN name_fn, const void *table );
+void sym_hash_free( SYM_HASH *hash );
+uint32_t sym_hash_find( const SYM_HASH *hash, const char *name, size_t len );
+uint32_t sym_hash_next( const SYM_HASH *hash, uint32_t sym );
+int sym_hash_mark_repeats( uint32_t count, SYM_NAME_FN name_fn, SYM_VALUE_FN value_fn,
+			   const void *table, uint8_t *dup );
+
+/*****************************************************************************
+ *	symcache.c
+ ****************************************************************************/
+
+int sym_cache_open( SYM_CACHE *cache, const char *path, IN_FILE *in, off_t sym_offset );
+void sym_cache_close( SYM_CACHE *cache );
+int sym_cache_write( const char *path, IN_FILE *in, off_t sym_offset, uint32_t count,
+		     SYM_NAME_FN name_fn, SYM_VALUE_FN value_fn,
+		     const void *table, uint32_t flags );
+uint32_t sym_cache_find( const SYM_CACHE *cache, const char *name, size_t len );
+uint32_t sym_cache_next( const SYM_CACHE *cache, uint32_t entry );
+
+/*****************************************************************************
+ *	symtab.c
+ ****************************************************************************/
+
+int sym_table_read_dri( SYM_TABLE *table, IN_FILE *in, uint32_t count );
+int sym_table_read_coff( SYM_TABLE *table, IN_FILE *in, uint32_t count );
+void sym_table_free( SYM_TABLE *table );
+const char *sym_table_name( const void *table, uint32_t sym, size_t *len );
+uint32_t sym_table_value( const void *table, uint32_t sym );
+
+/*****************************************************************************
+ *	objfile.c
+ ****************************************************************************/
+
+int obj_open( OBJ_FILE *obj, const char *filename );
+void obj_close( OBJ_FILE *obj );
+off_t obj_symbol_offset( const OBJ_FILE *obj );
+uint32_t obj_symbol_count( const OBJ_FILE *obj );
+int obj_dri_sorted( const OBJ_FILE *obj );
+int obj_read_symbols( OBJ_FILE *obj, SYM_TABLE *table );
+void obj_perror( FILE *fp, const OBJ_FILE *obj, int err, const char *filename );
+
+/*****************************************************************************
+ *	outbuf.c
+ ****************************************************************************/
+
+void out_flush( void );
+void out_bytes( const char *data, size_t len );
+void out_str( const char *str );
+void out_eol( void );
+void out_pad( const char *str, size_t width );
+void out_hex( uint32_t value, int digits );
+void out_udec( uint32_t value );
+void out_dec( int32_t value );
+
+/*****************************************************************************
+ *	symout.c
+ ****************************************************************************/
+
+int sym_format_parse( const char *name );
+void sym_write_begin( SYM_WRITER *writer, int format );
+int sym_write_symbol( SYM_WRITER *writer, const char *name, size_t len,
+		      uint32_t value, uint32_t type );
+void sym_write_end( SYM_WRITER *writer );
+
+/*****************************************************************************
+ *	symaddr.c
+ ****************************************************************************/
+
+int sym_addr_build( SYM_ADDR *index, SYM_ADDR_ENTRY *entries, uint32_t count );
+void sym_addr_free( SYM_ADDR *index );
+const SYM_ADDR_ENTRY *sym_addr_find( const SYM_ADDR *index, uint32_t addr );
+void sym_addr_find_batch( const SYM_ADDR *index, const uint32_t *addrs, uint32_t count, const SYM_ADDR_ENTRY **results );
+
+/*****************************************************************************
+ *	symsort.c
+ ****************************************************************************/
+
+uint64_t sym_name_prefix( const char *name, size_t len );
+void sym_sort_threads( int count );
+int sym_sort_keys( SYM_SORT_KEY *keys, uint32_t count, int fields,
+		   SYM_NAME_FN name_fn, const void *table );
+uint32_t sym_compact( void HUGE *records, size_t width, uint32_t count, const uint8_t *dup );
+void sym_mark_table_duplicates( const SYM_TABLE *table, uint8_t *dup );
+uint32_t sym_compact_table( SYM_TABLE *table, const uint8_t *dup );
+void sym_sort_apply( void *records, size_t width, const SYM_SORT_KEY *keys, uint32_t count,
+		     void *temp );
+int sym_sort_table( SYM_TABLE *table, int by_name );
+
+/*****************************************************************************
+ *	batch.c
+ ****************************************************************************/
+
+int batch_jobs_default( void );
+int batch_run( int count, char **names, int jobs, BATCH_FN fn );
@@ -1,4 +1,5 @@
-#include "osbind.h"
+#include "size.h"
+#include "proto.h"
 
 /* Why does VC++ make this so hard? Punting. */
 #if defined(__MSDOS__) || defined(_WIN32)
@@ -10,46 +11,218 @@
 #endif
 #endif
 
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#include <immintrin.h>
+#define HAVE_AVX2_DECODE
+#endif
+
 /************************************************************************/
 /************************************************************************/
 /************************************************************************/
 
-unsigned char readbyte( int fhand )
+/* Decode big-endian values straight out of a memory image of the file. */
+
+uint16_t getshort( const uint8_t *ptr )
 {
-char chr;
+	return ((uint16_t)ptr[0] << 8) | (uint16_t)ptr[1];
+}
 
-	Fread( fhand, 1L, &chr );
-	return( chr );
+uint32_t getlong( const uint8_t *ptr )
+{
+	return ((uint32_t)ptr[0] << 24) |
+		((uint32_t)ptr[1] << 16) |
+		((uint32_t)ptr[2] << 8) |
+		(uint32_t)ptr[3];
 }
 
-unsigned short readshort( int fhand )
+/* And encode them into a memory image of an output file. */
+
+void putshort( uint8_t *ptr, uint16_t val )
 {
-unsigned short s;
+	ptr[0] = (uint8_t)( val >> 8 );
+	ptr[1] = (uint8_t)val;
+}
 
-	Fread( fhand, 2L, &s );
-#ifdef SWAP_BYTES
-	s = (s << 8) | (s >> 8);
+void putlong( uint8_t *ptr, uint32_t val )
+{
+	ptr[0] = (uint8_t)( val >> 24 );
+	ptr[1] = (uint8_t)( val >> 16 );
+	ptr[2] = (uint8_t)( val >> 8 );
+	ptr[3] = (uint8_t)val;
+}
+
+/************************************************************************/
+/************************************************************************/
+/************************************************************************/
+
+/* Decode <count> BSD/COFF symbols from the file image at <data> straight */
+/* into the columns of a symbol table.  The name offsets come out less */
+/* the 4 bytes of the string table's size.  With AVX2, 8 symbols at a */
+/* time are loaded as three vectors of 8 dwords.  Each field is a dword */
+/* or fits in one, so the ones for each column are blended together, */
+/* moved into place with one permute, and byte swapped with one shuffle. */
+
+#ifdef HAVE_AVX2_DECODE
+__attribute__((target("avx2")))
+static uint32_t get_bsd_columns_avx2( const uint8_t *data, uint32_t count, uint32_t *names,
+				      uint16_t *types, uint16_t *descs, uint32_t *values )
+{
+const __m256i swap = _mm256_setr_epi8( 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+				       3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 );
+const __m256i split = _mm256_setr_epi8( 0, -1, 4, -1, 8, -1, 12, -1, 3, 2, 7, 6, 11, 10, 15, 14,
+					0, -1, 4, -1, 8, -1, 12, -1, 3, 2, 7, 6, 11, 10, 15, 14 );
+const __m256i name_order = _mm256_setr_epi32( 0, 3, 6, 1, 4, 7, 2, 5 );
+const __m256i mid_order = _mm256_setr_epi32( 1, 4, 7, 2, 5, 0, 3, 6 );
+const __m256i value_order = _mm256_setr_epi32( 2, 5, 0, 3, 6, 1, 4, 7 );
+const __m256i four = _mm256_set1_epi32( 4 );
+__m256i v0, v1, v2, name, mid, value;
+uint32_t sym;
+
+	for ( sym = 0; sym + 8 <= count; sym += 8, data += 96 )
+	{
+		v0 = _mm256_loadu_si256( (const __m256i *)data );
+		v1 = _mm256_loadu_si256( (const __m256i *)( data + 32 ) );
+		v2 = _mm256_loadu_si256( (const __m256i *)( data + 64 ) );
+
+/* Symbol n's dwords are 3n to 3n+2, and no two of a column's 8 share */
+/* a place in their vectors. */
+
+		name = _mm256_blend_epi32( _mm256_blend_epi32( v0, v1, 0x92 ), v2, 0x24 );
+		mid = _mm256_blend_epi32( _mm256_blend_epi32( v0, v1, 0x24 ), v2, 0x49 );
+		value = _mm256_blend_epi32( _mm256_blend_epi32( v0, v1, 0x49 ), v2, 0x92 );
+
+		name = _mm256_shuffle_epi8( _mm256_permutevar8x32_epi32( name, name_order ), swap );
+		value = _mm256_shuffle_epi8( _mm256_permutevar8x32_epi32( value, value_order ), swap );
+		_mm256_storeu_si256( (__m256i *)( names + sym ), _mm256_sub_epi32( name, four ) );
+		_mm256_storeu_si256( (__m256i *)( values + sym ), value );
+
+/* The middle dword is the type and other bytes and the description. */
+/* Each half gathers its types and then its descriptions, and the */
+/* quarters are put back in order to make the two columns. */
+
+		mid = _mm256_shuffle_epi8( _mm256_permutevar8x32_epi32( mid, mid_order ), split );
+		mid = _mm256_permute4x64_epi64( mid, 0xd8 );
+		_mm_storeu_si128( (__m128i *)( types + sym ), _mm256_castsi256_si128( mid ) );
+		_mm_storeu_si128( (__m128i *)( descs + sym ), _mm256_extracti128_si256( mid, 1 ) );
+	}
+	return sym;
+}
 #endif
-	return( s );
+
+void get_bsd_columns( const uint8_t *data, uint32_t count, uint32_t *names,
+		      uint16_t *types, uint16_t *descs, uint32_t *values )
+{
+uint32_t sym = 0;
+
+#ifdef HAVE_AVX2_DECODE
+	if ( __builtin_cpu_supports( "avx2" ) )
+		sym = get_bsd_columns_avx2( data, count, names, types, descs, values );
+#endif
+
+	for ( data += sym * 12; sym < count; sym++ )
+	{
+		names[sym] = getlong( data ) - 4;
+		types[sym] = data[4];
+		descs[sym] = getshort( data + 6 );
+		values[sym] = getlong( data + 8 );
+		data += 12;
+	}
 }
 
-unsigned long readlong( int fhand )
+/* The same for the types and values of <count> DRI symbols, which are */
+/* 14 bytes each and don't line up with anything.  With AVX2, each half */
+/* of a vector is loaded with a symbol of its own and shuffled to put */
+/* its value and type first, and four such vectors are unpacked into */
+/* the 8 values and 8 types.  A 16 byte load runs 2 bytes into the next */
+/* symbol, so the last 8 or fewer are left for the scalar code. */
+
+#ifdef HAVE_AVX2_DECODE
+__attribute__((target("avx2")))
+static __m256i get_dri_pair( const uint8_t *data, __m256i swap )
 {
-unsigned long l;
-#ifdef SWAP_BYTES
-unsigned long a, b, c, d;
+__m256i pair;
+
+	pair = _mm256_castsi128_si256( _mm_loadu_si128( (const __m128i *)data ) );
+	pair = _mm256_inserti128_si256( pair, _mm_loadu_si128( (const __m128i *)( data + 14 ) ), 1 );
+	return _mm256_shuffle_epi8( pair, swap );
+}
+
+__attribute__((target("avx2")))
+static uint32_t get_dri_columns_avx2( const uint8_t *data, uint32_t count,
+				      uint16_t *types, uint32_t *values )
+{
+const __m256i swap = _mm256_setr_epi8( 13, 12, 11, 10, 9, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+				       13, 12, 11, 10, 9, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 );
+const __m256i order = _mm256_setr_epi32( 0, 4, 1, 5, 2, 6, 3, 7 );
+__m256i a, b, c, d, value, type;
+uint32_t sym;
+
+	for ( sym = 0; sym + 8 < count; sym += 8, data += 112 )
+	{
+		a = get_dri_pair( data, swap );
+		b = get_dri_pair( data + 28, swap );
+		c = get_dri_pair( data + 56, swap );
+		d = get_dri_pair( data + 84, swap );
+
+		a = _mm256_unpacklo_epi32( a, b );
+		c = _mm256_unpacklo_epi32( c, d );
+		value = _mm256_permutevar8x32_epi32( _mm256_unpacklo_epi64( a, c ), order );
+		type = _mm256_permutevar8x32_epi32( _mm256_unpackhi_epi64( a, c ), order );
+		type = _mm256_permute4x64_epi64( _mm256_packus_epi32( type, type ), 0x08 );
+
+		_mm256_storeu_si256( (__m256i *)( values + sym ), value );
+		_mm_storeu_si128( (__m128i *)( types + sym ), _mm256_castsi256_si128( type ) );
+	}
+	return sym;
+}
 #endif
 
-	Fread( fhand, 4L, &l );
-#ifdef SWAP_BYTES
-	a = (l >> 24) & 0x000000ffL;
-	b = (l >> 8) & 0x0000ff00L;
-	c = (l << 8) & 0x00ff0000L;
-	d = (l << 24) & 0xff000000L;
-	return( a | b | c | d );
-#else
-	return( l );
+void get_dri_columns( const uint8_t *data, uint32_t count, uint16_t *types, uint32_t *values )
+{
+uint32_t sym = 0;
+
+#ifdef HAVE_AVX2_DECODE
+	if ( __builtin_cpu_supports( "avx2" ) )
+		sym = get_dri_columns_avx2( data, count, types, values );
 #endif
+
+	for ( data += sym * 14; sym < count; sym++ )
+	{
+		types[sym] = getshort( data + 8 );
+		values[sym] = getlong( data + 10 );
+		data += 14;
+	}
+}
+
+/************************************************************************/
+/************************************************************************/
+/************************************************************************/
+
+unsigned char readbyte( IN_FILE *in )
+{
+const uint8_t *ptr;
+
+	if ( ( ptr = in_get( in, 1 ) ) == NULL )
+		return( 0 );
+	return( *ptr );
+}
+
+unsigned short readshort( IN_FILE *in )
+{
+const uint8_t *ptr;
+
+	if ( ( ptr = in_get( in, 2 ) ) == NULL )
+		return( 0 );
+	return( getshort( ptr ) );
+}
+
+unsigned long readlong( IN_FILE *in )
+{
+const uint8_t *ptr;
+
+	if ( ( ptr = in_get( in, 4 ) ) == NULL )
+		return( 0 );
+	return( getlong( ptr ) );
 }
 
 long writelong( int fhand, long lval )
@@ -36,602 +36,431 @@
 /**************************************************************************/
 /**************************************************************************/
 
-ABS_HDR theHeader, tmpHeader;
-COF_HDR coff_header;
-RUN_HDR run_header;
-SEC_HDR txt_header, dta_header, bss_header;
-BSD_Object bsd_object;
-BSD_Symbol *coff_symbols;
+/* Options, set up before any file is looked at */
 
 int show_symbols = 0;
 int skip_duplicates = 1;
+int unique_symbols = 0;		/* -u: skip repeats by hashing, in any order */
 int sort_options = SORT_BY_VALUE;
 int opt_skip_line_numbers = 0;
-
-char *coff_symbol_name_strings;
-
-static uint32_t dri_symbol_value( const void *s )
-{
-	const uint8_t *uptr = s;
-	uptr += 10;
-
-	return ((uint32_t)uptr[0] << 24) |
-		((uint32_t)uptr[1] << 16) |
-		((uint32_t)uptr[2] << 8) |
-		(uint32_t)uptr[3];
-}
+int out_format = SYM_FORMAT_TEXT;	/* --format=: how the symbols are listed */
+int show_info = 1;			/* Print what's in the headers */
+int show_summary = 0;			/* --summary: one line of sizes per file */
+int file_count = 0;
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
-/* Returns -1 if a<b, 0 if a=b, or 1 if a>b */
-
-int dri_symbol_compare( const void *a, const void *b )
-{
-char HUGE *aa, HUGE *bb;
-int i;
-uint32_t sym_a_val, sym_b_val;
 
-	aa = (char HUGE *)a;
-	bb = (char HUGE *)b;
-	
-	if( sort_options == SORT_BY_NAME )
-	{
-		for( i = 0; i < 8; i++ )	/* Check byte by byte so it fails faster! */
-		{
-			if( *aa > *bb )
-			  return(1);
-			else if( *aa < *bb )
-			  return(-1);
+/* DRI names are compared as all 8 bytes by sym_hash_mark_repeats(), */
+/* as they are when sorting. */
 
-			aa++;
-			bb++;
-		}
-	}
-
-/* If sorting by name, but they are the same, then check value. */
-/* Or if we are sorting by value instead... */
+static const char *dri_table_name( const void *table, uint32_t sym, size_t *len )
+{
+const SYM_TABLE *symtab = table;
 
-	sym_a_val = dri_symbol_value(a);
-	sym_b_val = dri_symbol_value(b);
-	
-	if( sym_a_val > sym_b_val )
-	  return(1);
-	else if( sym_a_val < sym_b_val )
-	  return(-1);
-	else
-	  return(0);
+	*len = 8;
+	return symtab->pool + symtab->names[sym];
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-/* Returns -1 if a<b, 0 if a=b, or 1 if a>b */
+/* Print what was asked for about the file open in <obj>.  Returns 0, or */
+/* -1 if something went wrong (which has been reported). */
 
-int coff_symbol_compare( const void *a, const void *b )
+short process_abs_file( OBJ_FILE *obj )
 {
-BSD_Symbol HUGE *sym1, HUGE *sym2;
-int32_t offset;
-char HUGE *str1, HUGE *str2;
-int i;
-
-	sym1 = (BSD_Symbol *)a;
-	sym2 = (BSD_Symbol *)b;
-
-	i = 0;
-	if( sort_options == SORT_BY_NAME )
-	{
-		offset = sym1->name_offset;
-		str1 = &coff_symbol_name_strings[offset] - 4;
-		offset = sym2->name_offset;
-		str2 = &coff_symbol_name_strings[offset] - 4;
-	
-		i = strcmp(str1, str2);
-	}
-	else if( sort_options == SORT_BY_VALUE )
+	switch( obj->kind )
 	{
-		if( sym1->value > sym2->value )
-		  return(1);
-		else if( sym1->value < sym2->value )
-		  return(-1);
-		else
-		  i = 0;
+	case OBJ_DRI_ABS:
+	case OBJ_DRI_OBJECT:
+		if( show_info && obj->kind == OBJ_DRI_ABS )
+		  printf("DRI/Alcyon format absolute location executable file detected \n");
+		else if( show_info )
+		  printf("DRI/Alcyon format relocatable object module file detected \n");
+
+		if( show_info )
+		  print_dri_info( obj );
+		if( show_summary )
+		  print_summary( obj->name, obj->header.tsize, obj->header.dsize, obj->header.bsize );
+		else if( show_symbols )
+		  return print_dri_symbols( obj );
+		break;
+
+	case OBJ_COFF:
+		if( show_info )
+		{
+			printf("COFF format absolute executable program file detected.\n");
+			print_coff_info( obj );
+		}
+		if( show_summary )
+		  print_summary( obj->name, obj->run_header.tsize, obj->run_header.dsize, obj->run_header.bsize );
+		else if( show_symbols )
+		  return print_coff_symbols( obj );
+		break;
+
+	case OBJ_BSD:
+		if( show_info )
+		{
+			printf( "BSD format object module file detected.\n" );
+			print_coff_info( obj );
+		}
+		if( show_summary )
+		  print_summary( obj->name, obj->bsd_object.tsize, obj->bsd_object.dsize, obj->bsd_object.bsize );
+		else if( show_symbols )
+		  return print_coff_symbols( obj );
+		break;
 	}
-	return(i);
+	return(0);
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-/* Read in a BSD/COFF SEC_HDR structure from the file. */
-/* For Jaguar we don't really care about all of the fields, */
-/* but we still have to read them all! */
-
-void read_sec_hdr( int in_handle, SEC_HDR *section )
+void print_dri_info( const OBJ_FILE *obj )
 {
-	Fread(in_handle, 8L, &section->name);
+	printf( "Text segment size = 0x%08" PRIx32 " bytes\n", obj->header.tsize );
+	printf( "Data segment size = 0x%08" PRIx32 " bytes\n", obj->header.dsize );
+	printf( "BSS Segment size = 0x%08" PRIx32 " bytes\n", obj->header.bsize );
 
-	section->start_address = readlong(in_handle);
-	section->start_address_2 = readlong(in_handle);
+	printf( "Symbol Table size = 0x%08" PRIx32 " bytes\n", obj->header.ssize );
 
-	section->size = readlong(in_handle);
-
-	section->offset = readlong(in_handle);
-	section->relocation_data = readlong(in_handle);
-	section->debug_info = readlong(in_handle);
-	section->num_reloc_entries = readshort(in_handle);
-	section->num_debug_entries = readshort(in_handle);
-	section->flags = readlong(in_handle);
+	if( obj->kind != OBJ_DRI_OBJECT )		/* If not an OBJECT module */
+	{
+		printf( "Absolute Address for text segment = 0x%08" PRIx32 "\n", obj->header.tbase );
+		printf( "Absolute Address for data segment = 0x%08" PRIx32 "\n", obj->header.dbase );
+		printf( "Absolute Address for BSS segment = 0x%08" PRIx32 "\n\n", obj->header.bbase );
+	}
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-/* Read the header, determine if the file is BSD/COFF or DRI format, then */
-/* do the appropriate steps to write out the TEXT, DATA, and maybe the */
-/* SYMBOLS file */
-
-short process_abs_file( char *fname, int in_handle )
+void print_coff_info( const OBJ_FILE *obj )
 {
-char *ptr, original_fname[256];
-
-/* Save a copy of the original filename, then strip off the filename extension. */
+	if( obj->kind == OBJ_COFF )
+	{
+//		printf( "%d sections specified\n", obj->coff_header.num_sections);
+//		printf( "The additional header size is %d bytes\n", obj->coff_header.opt_hdr_size );
+//		printf( "Magic Number for RUN_HDR = 0x%08" PRIx32 "\n", obj->run_header.magic );
 
-	strncpy( original_fname, fname, 256 );
-	if((ptr = strchr(fname,'.')) != NULL)
-	  *ptr=0;
+		printf( "Text Segment Size = 0x%08" PRIx32 "\n", obj->run_header.tsize );
+		printf( "Data Segment Size = 0x%08" PRIx32 "\n", obj->run_header.dsize );
+		printf( "BSS Segment Size = 0x%08" PRIx32 "\n", obj->run_header.bsize );
 
-	theHeader.magic = readshort( in_handle );
-	
-/* BSD Objects have a LONG magic number, so move to start, read it, */
-/* then move back to where we started. (At 2 bytes into file). */
+//		printf( "Symbol Table offset = %ld (0x%08" PRIx32 ")\n", obj->coff_header.sym_offset, obj->coff_header.sym_offset );
 
-	Fseek( 0L, in_handle, 0 );
-	bsd_object.magic = readlong(in_handle);
-	Fseek( 2L, in_handle, 0 );
+		printf( "Symbol Table contains %" PRId32 " symbol entries\n", obj->coff_header.num_symbols );
 
-/* See if the magic number indicates a DRI/Alcyon-format executable or object module file */
+		printf( "Starting Address for executable = 0x%08" PRIx32 "\n", obj->run_header.entry );
+		printf( "Start of Text Segment = 0x%08" PRIx32 "\n", obj->run_header.tbase );
+		printf( "Start of Data Segment = 0x%08" PRIx32 "\n", obj->run_header.dbase );
 	
-	if( theHeader.magic == 0x601b || theHeader.magic == 0x601a )
-	{			
-		read_dri_header( in_handle );
-		print_dri_info();
-		if( show_symbols )
-		  print_dri_symbols( in_handle );
-		return(1);
+		printf( "Start of BSS Segment = 0x%08" PRIx32 "\n\n", obj->bss_header.start_address );
 	}
-
-/* Not DRI-format, so test for BSD/COFF. */
-	
-	else if( theHeader.magic == 0x0150 ||
-		(theHeader.magic == 0x0000 && bsd_object.magic == 0x00000107L) )
-	{
-		read_coff_header( in_handle );
-		print_coff_info();
-		if( show_symbols )
-		  print_coff_symbols( in_handle );
-		return(1);
-	}
-
-/* Sorry, don't know what it is. */
-
 	else
 	{
-		printf("Error: Wrong file type.  Magic number = 0x%04x\n", theHeader.magic );
-		Fclose(in_handle);
-		exit(1);
+		printf( "Text Segment Size = 0x%08" PRIx32 "\n", obj->bsd_object.tsize );
+		printf( "Data Segment Size = 0x%08" PRIx32 "\n", obj->bsd_object.dsize );
+		printf( "BSS Segment Size = 0x%08" PRIx32 "\n", obj->bsd_object.bsize );
 	}
-	return(0);
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-void read_dri_header( int in_handle )
-{
-	theHeader.tsize = readlong(in_handle);
-	theHeader.dsize = readlong(in_handle);
-	theHeader.bsize = readlong(in_handle);
-	theHeader.ssize = readlong(in_handle);
-
-	if( theHeader.magic == 0x601b )		/* If it's an executable... */
-	{
-		printf("DRI/Alcyon format absolute location executable file detected \n");
-		theHeader.res1 = readlong(in_handle);		/* not used... */
-		theHeader.tbase = readlong(in_handle);
-		theHeader.relocflag = readshort(in_handle);	/* not used... */
-		theHeader.dbase = readlong(in_handle);
-		theHeader.bbase = readlong(in_handle);
-	}
-	else					/* If it's an OBJECT MODULE... */
-	{
-		printf("DRI/Alcyon format relocatable object module file detected \n");
-	}
-}
-
-/**************************************************************************/
-/**************************************************************************/
-/**************************************************************************/
+/* A line of the --summary table, like the one GNU size prints. */
 
-void read_coff_header( int in_handle )
+void print_summary( const char *fname, uint32_t tsize, uint32_t dsize, uint32_t bsize )
 {
-	if( theHeader.magic == 0x0150 )
-	{
-		printf("COFF format absolute executable program file detected.\n");
-		Fseek( 0L, in_handle, 0 );
-
-		coff_header.magic = readshort(in_handle);
-		coff_header.num_sections = readshort(in_handle);
-		coff_header.date = readlong(in_handle);
-		coff_header.sym_offset = readlong(in_handle);
-		coff_header.num_symbols = readlong(in_handle);
-		coff_header.opt_hdr_size = readshort(in_handle);
-		coff_header.flags = readshort(in_handle);
-
-		run_header.magic = readlong(in_handle);
-		run_header.tsize = readlong(in_handle);
-		run_header.dsize = readlong(in_handle);
-		run_header.bsize = readlong(in_handle);
-		run_header.entry = readlong(in_handle);
-		run_header.tbase = readlong(in_handle);
-		run_header.dbase = readlong(in_handle);
-	}
-	else
-	{		
-		printf( "BSD format object module file detected.\n" );
-		Fseek( 0L, in_handle, 0 );
-
-		bsd_object.magic = readlong(in_handle);
-		bsd_object.tsize = readlong(in_handle);
-		bsd_object.dsize = readlong(in_handle);
-		bsd_object.bsize = readlong(in_handle);
-		bsd_object.ssize = readlong(in_handle);
-		bsd_object.entry = readlong(in_handle);
-		bsd_object.trsize = readlong(in_handle);
-		bsd_object.drsize = readlong(in_handle);
-
-		coff_header.num_sections = 3;
-
-		coff_header.sym_offset = PACKED_SIZEOF(BSD_Object);
-		coff_header.sym_offset += bsd_object.tsize;
-		coff_header.sym_offset += bsd_object.dsize;
-		coff_header.sym_offset += bsd_object.trsize;
-		coff_header.sym_offset += bsd_object.drsize;
-		
-		coff_header.num_symbols = bsd_object.ssize / PACKED_SIZEOF(BSD_Symbol);
-		coff_header.opt_hdr_size = 0L;
-		coff_header.flags = 0L;
-	}
-	
-	read_sec_hdr(in_handle, &txt_header);
-	read_sec_hdr(in_handle, &dta_header);
-	read_sec_hdr(in_handle, &bss_header);
-
-/* OK, now we've gotta set up the DRI-format ABS header so */
-/* that we can use it to write the RDBJAG script file later. */
-
-	theHeader.tsize = txt_header.size;
-	theHeader.tbase = txt_header.start_address;
+uint32_t total = tsize + dsize + bsize;
 
-	theHeader.dsize = dta_header.size;
-	theHeader.dbase = dta_header.start_address;
-
-	theHeader.bsize = bss_header.size;
-	theHeader.bbase = bss_header.start_address;
-
-	theHeader.ssize = 0;		/* We don't do anything with symbols yet... */
-	theHeader.res1 = 0;		/* not used... */
-	theHeader.relocflag = 0;	/* not used... */
+	printf( "%7" PRIu32 " %7" PRIu32 " %7" PRIu32 " %7" PRIu32 " %7" PRIx32 " %s\n",
+		tsize, dsize, bsize, total, total, fname );
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-void print_dri_info(void)
-{
-	printf( "Text segment size = 0x%08" PRIx32 " bytes\n", theHeader.tsize );
-	printf( "Data segment size = 0x%08" PRIx32 " bytes\n", theHeader.dsize );
-	printf( "BSS Segment size = 0x%08" PRIx32 " bytes\n", theHeader.bsize );
+/* Load the symbols of the file open in <obj>, sort them as asked, and */
+/* mark the ones to skip in *<dup> (which is left NULL if none are to */
+/* be).  A symbol that's the same as the one after it once sorted is */
+/* a repeat, or with -u, any later one with the same name and value. */
+/* Returns 0, or -1 if something went wrong (which has been reported). */
 
-	printf( "Symbol Table size = 0x%08" PRIx32 " bytes\n", theHeader.ssize );
+static int load_symbols( OBJ_FILE *obj, SYM_TABLE *table, uint8_t **dup )
+{
+int err;
 
-	if( theHeader.magic != 0x601a )		/* If not an OBJECT module */
+	*dup = NULL;
+	if( ( err = obj_read_symbols( obj, table ) ) < 0 )
 	{
-		printf( "Absolute Address for text segment = 0x%08" PRIx32 "\n", theHeader.tbase );
-		printf( "Absolute Address for data segment = 0x%08" PRIx32 "\n", theHeader.dbase );
-		printf( "Absolute Address for BSS segment = 0x%08" PRIx32 "\n\n", theHeader.bbase );
+		obj_perror( stdout, obj, err, obj->name );
+		return(-1);
 	}
-}
-
-/**************************************************************************/
-/**************************************************************************/
-/**************************************************************************/
-
-void print_coff_info(void)
-{
-	if( theHeader.magic == 0x0150 )
-	{
-//		printf( "%d sections specified\n", coff_header.num_sections);
-//		printf( "The additional header size is %d bytes\n", coff_header.opt_hdr_size );
-//		printf( "Magic Number for RUN_HDR = 0x%08" PRIx32 "\n", run_header.magic );
-
-		printf( "Text Segment Size = 0x%08" PRIx32 "\n", run_header.tsize );
-		printf( "Data Segment Size = 0x%08" PRIx32 "\n", run_header.dsize );
-		printf( "BSS Segment Size = 0x%08" PRIx32 "\n", run_header.bsize );
-
-//		printf( "Symbol Table offset = %ld (0x%08" PRIx32 ")\n", coff_header.sym_offset, coff_header.sym_offset );
 
-		printf( "Symbol Table contains %" PRId32 " symbol entries\n", coff_header.num_symbols );
+/* A .sym file from filefix is already in name order. */
 
-		printf( "Starting Address for executable = 0x%08" PRIx32 "\n", run_header.entry );
-		printf( "Start of Text Segment = 0x%08" PRIx32 "\n", run_header.tbase );
-		printf( "Start of Data Segment = 0x%08" PRIx32 "\n", run_header.dbase );
-	
-		printf( "Start of BSS Segment = 0x%08" PRIx32 "\n\n", bss_header.start_address );
-	}
-	else
+	if( ( sort_options != SORT_NONE &&
+	      ! ( sort_options == SORT_BY_NAME && obj_dri_sorted( obj ) ) &&
+	      sym_sort_table( table, sort_options == SORT_BY_NAME ) < 0 ) ||
+	    ( skip_duplicates && ( *dup = malloc( table->count + 1 ) ) == NULL ) ||
+	    ( *dup && unique_symbols &&
+	      sym_hash_mark_repeats( table->count, table->dri_names ? dri_table_name : sym_table_name,
+				     sym_table_value, table, *dup ) < 0 ) )
 	{
-		printf( "Text Segment Size = 0x%08" PRIx32 "\n", bsd_object.tsize );
-		printf( "Data Segment Size = 0x%08" PRIx32 "\n", bsd_object.dsize );
-		printf( "BSS Segment Size = 0x%08" PRIx32 "\n", bsd_object.bsize );
+		printf( "Cannot allocate memory for symbol information!\n" );
+		free( *dup );
+		*dup = NULL;
+		sym_table_free( table );
+		return(-1);
 	}
+
+	if( *dup && ! unique_symbols )
+	  sym_mark_table_duplicates( table, *dup );
+	return(0);
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-void print_dri_symbols( int fhand )
+/* Returns 0, or -1 if the symbols couldn't be read. */
+
+int print_dri_symbols( OBJ_FILE *obj )
 {
-char HUGE *ptr;
-uint8_t *uptr;
-int32_t longcount, skipped, offset;
-void HUGE *symbuf, HUGE *a, HUGE *b;
-
-	printf( "\nDump of symbols in this file:\n\n" );
-
-/* Read the symbols, sort them, print them. */
-/* This sort of assumes your symbol table will fit in available */
-/* memory (MSDOS memory... less than 600K), but this shouldn't be */
-/* a big problem. */
-
-	if( theHeader.magic == 0x601b )					/* ABS executable */
-	  offset = PACKED_SIZEOF(ABS_HDR) + theHeader.tsize + theHeader.dsize;
-	else								/* Object Module */
-	  offset = PACKED_SIZEOF(DRI_Object) + theHeader.tsize + theHeader.dsize;
-
-	Fseek( offset, fhand, 0 );
-	symbuf = farmalloc(theHeader.ssize);
-	if( ! symbuf)
-	{
-		printf( "Cannot allocate sufficient memory (%" PRId32 " bytes) for buffer!\n", theHeader.ssize );
-		exit(-1);
-	}
+SYM_TABLE table;
+SYM_WRITER writer;
+uint32_t sym, skipped;
+int32_t offset;
+uint8_t *dup;
+const char *name;
+char padded[8];
+size_t len;
 
-/* Read the symbols one at a time (because doing it in one chunk isn't working right...) */
+	if( out_format == SYM_FORMAT_TEXT )
+	  printf( "\nDump of symbols in this file:\n\n" );
 
-	printf( "Reading symbols from offset %" PRId32 " (0x%08" PRIx32 ")...\n", offset, offset );
-	ptr = (char FAR *)symbuf;
-	for( longcount = 0; longcount < theHeader.ssize; longcount += 14 )
-	{
-		Fread( fhand, 14L, ptr );
-		ptr += 14;
-	}
+	offset = (int32_t)obj_symbol_offset( obj );
+	if( out_format == SYM_FORMAT_TEXT )
+	  printf( "Reading symbols from offset %" PRId32 " (0x%08" PRIx32 ")...\n", offset, offset );
+
+	if( load_symbols( obj, &table, &dup ) < 0 )
+	  return(-1);
 
-	if( sort_options != SORT_NONE )
-	  my_qsort( symbuf, (int)(theHeader.ssize/14), 14, dri_symbol_compare );
+	if( out_format != SYM_FORMAT_TEXT )
+	  sym_write_begin( &writer, out_format );
 
-	ptr = symbuf;
 	skipped = 0;
-	for (longcount = 0 ; longcount < theHeader.ssize ; longcount += 14)
+	for( sym = 0; sym < table.count; sym++ )
 	{
-	int show_it;
-	
-		a = ptr;
-		b = (char HUGE *)a + 14;
-		uptr = (uint8_t *)ptr;
-
-		show_it = 1;
-		if( skip_duplicates && ( (longcount+14) < theHeader.ssize ) )
+		if( dup && dup[sym] )
 		{
-			show_it = dri_symbol_compare(a,b);
-			if( ! show_it )
-			  skipped++;
+			skipped++;
+			continue;
 		}
 
-		if( show_it )
+		name = table.pool + table.names[sym];
+		if( out_format != SYM_FORMAT_TEXT )
 		{
-		short i;
+			for( len = 0; len < 8 && name[len]; len++ )
+			  ;
+			if( sym_write_symbol( &writer, name, len, table.values[sym], table.types[sym] ) < 0 )
+			  break;
+			continue;
+		}
 
-			for( i = 0; i < 8; i++ )
-			{
-				if( ptr[i] == 0 )
-				{
-					for( ; i < 8; i++ )
-					  ptr[i] = ' ';
-				}
-			}
+/* Everything from the first NUL on is shown as spaces. */
 
-/* print the values byte by byte because it works on any machine... */
-			
-			printf( "0x%02x%02x%02x%02x",
-				(unsigned int)uptr[10], (unsigned int)uptr[11],
-				(unsigned int)uptr[12], (unsigned int)uptr[13] );
+		for( len = 0; len < 8 && name[len]; len++ )
+		  padded[len] = name[len];
+		for( ; len < 8; len++ )
+		  padded[len] = ' ';
 
-//printf( "0x%08" PRIx32 ": ", ptr );
+		out_bytes( "0x", 2 );
+		out_hex( table.values[sym], 8 );
 
-			printf( "\t%c%c%c%c%c%c%c%c\t",
-				ptr[0], ptr[1], ptr[2], ptr[3],
-				ptr[4], ptr[5], ptr[6], ptr[7] );
+		out_bytes( "\t", 1 );
+		out_bytes( padded, 8 );
+		out_bytes( "\t", 1 );
 
-//printf( "\t%02x%02x%02x%02x%02x%02x%02x%02x\n",
-//	ptr[0], ptr[1], ptr[2], ptr[3],
-//	ptr[4], ptr[5], ptr[6], ptr[7] );
-				
-			show_dri_symbol_type( ((unsigned int)uptr[8] * 256) + uptr[9] );
-		}
-		ptr += 14;
+		show_dri_symbol_type( table.types[sym] );
+	}
+
+	if( sym < table.count )
+	{
+		fprintf( stderr, "Cannot allocate memory for symbol names!\n" );
+		free( dup );
+		sym_table_free( &table );
+		return(-1);
 	}
 
-	printf( "\n" );
+	if( out_format != SYM_FORMAT_TEXT )
+	  sym_write_end( &writer );
+	else
+	{
+		out_flush();
+		printf( "\n" );
 	
-	if( skipped )
-	  printf( "%" PRId32 " duplicate symbol names were skipped.\n", skipped );
+		if( skipped )
+		  printf( "%" PRIu32 " duplicate symbol names were skipped.\n", skipped );
 
-	printf( "\n\n" );
-	farfree( symbuf );
+		printf( "\n\n" );
+	}
+	free( dup );
+	sym_table_free( &table );
+	return(0);
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
+/* The names of the type bits in the high byte of a DRI symbol type, */
+/* in the order they're printed. */
+
+static const char *dri_type_bits[8] =
+{
+	"Defined ", "Equate ", "Global ", "Equated Register ",
+	"External ", "Data ", "Text ", "BSS "
+};
+
 void show_dri_symbol_type( unsigned int symtype )
 {
-unsigned int mask, bit;
+static char names[256][64];
+static short names_ready = 0;
+int high, bit;
+
+/* Work out the names for every combination of bits once, up front. */
 
-	for( mask = 0x8000; mask != 0; mask >>= 1 )
+	if( ! names_ready )
 	{
-		bit = mask & symtype;
-		switch( bit )
+		for( high = 0; high < 256; high++ )
 		{
-			case 0x8000:
-				printf( "Defined " );
-				break;
-			case 0x4000:
-				printf( "Equate " );
-				break;
-			case 0x2000:
-				printf( "Global " );
-				break;
-			case 0x1000:
-				printf( "Equated Register " );
-				break;
-			case 0x0800:
-				printf( "External " );
-				break;
-			case 0x0400:
-				printf( "Data " );
-				break;
-			case 0x0200:
-				printf( "Text " );
-				break;
-			case 0x0100:
-				printf( "BSS " );
-				break;
+			names[high][0] = 0;
+			for( bit = 0; bit < 8; bit++ )
+			{
+				if( high & ( 0x80 >> bit ) )
+				  strcat( names[high], dri_type_bits[bit] );
+			}
 		}
+		names_ready = 1;
 	}
-	printf( " (0x%04x)\n", symtype );
+
+	out_str( names[( symtype >> 8 ) & 0xff] );
+	out_bytes( " (0x", 4 );
+	out_hex( symtype, 4 );
+	out_bytes( ")", 1 );
+	out_eol();
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-void print_coff_symbols( int fhand )
-{
-int32_t sym, symsize, stringtable_size, offset;
-int32_t skipped, unknown_type;
+/* Returns 0, or -1 if the symbols couldn't be read. */
 
-	printf( "\nDump of symbols in this file:\n\n" );
+int print_coff_symbols( OBJ_FILE *obj )
+{
+SYM_TABLE table;
+SYM_WRITER writer;
+uint32_t sym, skipped, unknown_type;
+uint8_t *dup;
+const char *name;
+int type;
 
-/* Calculate the size needed for the symbol table */
+	if( out_format == SYM_FORMAT_TEXT )
+	  printf( "\nDump of symbols in this file:\n\n" );
 
-	symsize = coff_header.num_symbols * sizeof(BSD_Symbol);
+	if( load_symbols( obj, &table, &dup ) < 0 )
+	  return(-1);
 
-/* Move to the symbol table, allocate memory for it */
-	
-	offset = coff_header.sym_offset;
-	Fseek(offset,fhand,0);
+	if( out_format != SYM_FORMAT_TEXT )
+	  sym_write_begin( &writer, out_format );
 
-	coff_symbols = (BSD_Symbol *)farmalloc( symsize );
-	if( ! coff_symbols )
+	skipped = unknown_type = 0;
+	for( sym = 0; sym < table.count; sym++ )
 	{
-		printf( "Cannot allocate memory for symbol information!\n" );
-		exit(-1);
-	}
+		if( dup && dup[sym] )	/* another symbol has the same name */
+		{
+			skipped++;
+			continue;
+		}
 
-/* Read the symbols in one by one */
+		name = table.pool + table.names[sym];
+		type = table.types[sym];
 
-	for( sym = 0; sym < coff_header.num_symbols; sym++ )
-	{
-		coff_symbols[sym].name_offset = readlong( fhand );
-		coff_symbols[sym].type = readbyte( fhand );
-		coff_symbols[sym].other = readbyte( fhand );
-		coff_symbols[sym].description = readshort( fhand );
-		coff_symbols[sym].value = readlong( fhand );
-	}
+/* The line numbers can be left out of the machine readable listings too, */
+/* but everything else goes in as it is. */
 
-/* Get the size of the string table (the name strings that go with */
-/* the symbols) then allocate some memory and read it in. */
-/* The string table starts with a longword containing the size, so the */
-/* offsets used by the symbols must be adjusted by -4 when you access */
-/* the individual strings. */
+		if( out_format != SYM_FORMAT_TEXT )
+		{
+			if( ( ! opt_skip_line_numbers || ( type != 0x44 && type != 0x48 && type != 0x4C ) ) &&
+			    sym_write_symbol( &writer, name, strlen( name ), table.values[sym], (uint32_t)type ) < 0 )
+			  break;
+		}
+		else
+		  unknown_type += show_bsd_symbol_type( (int32_t)table.values[sym], name, type,
+							table.descs[sym] );
+	}	
 
-	stringtable_size = readlong( fhand );
-	
-	coff_symbol_name_strings = farmalloc( stringtable_size );
-	if( ! coff_symbol_name_strings )
+	if( sym < table.count )
 	{
-		printf( "Cannot allocate memory for symbol information!\n" );
-		exit(-1);
+		fprintf( stderr, "Cannot allocate memory for symbol names!\n" );
+		free( dup );
+		sym_table_free( &table );
+		return(-1);
 	}
 
-	Fread( fhand, stringtable_size, coff_symbol_name_strings );
-
-	if( sort_options != SORT_NONE )
-	  my_qsort( coff_symbols, (int)coff_header.num_symbols, sizeof(BSD_Symbol), coff_symbol_compare );
-
-	skipped = unknown_type = 0;
-	for( sym = 0; sym < coff_header.num_symbols; sym++ )
+	if( out_format != SYM_FORMAT_TEXT )
+	  sym_write_end( &writer );
+	else
 	{
-	int32_t offset, value;
-	int type, other, description, show_it;
-	
-		offset = coff_symbols[sym].name_offset - 4;	/* Adjust offset by -4 as mentioned earlier... */
-		value = coff_symbols[sym].value;
-		type = (int)coff_symbols[sym].type;
-		other = (int)coff_symbols[sym].other;
-		description = (int)coff_symbols[sym].description;
-
-		show_it = 1;	/* assume we're showing it until we learn otherwise... */
-
-		if( skip_duplicates )
-		{
-			/* the compare function will return 0 if the symbol names are the same */
-			
-			show_it = coff_symbol_compare(&coff_symbols[sym], &coff_symbols[sym+1]);
-			if( ! show_it )
-			  skipped++;
-		}
-
-		if( show_it )
-		  unknown_type += show_bsd_symbol_type( value, &coff_symbol_name_strings[offset], type, other, description );
-	}	
-
-	printf( "\n" );
-	if( skipped )
-	  printf( "%" PRId32 " duplicate symbol names were skipped.\n", skipped );
-	if( unknown_type )
-	  printf( "%" PRId32 " symbols were special source-level debugging flags.\n", unknown_type );
-	printf( "\n\n" );
+		out_flush();
+		printf( "\n" );
+		if( skipped )
+		  printf( "%" PRIu32 " duplicate symbol names were skipped.\n", skipped );
+		if( unknown_type )
+		  printf( "%" PRIu32 " symbols were special source-level debugging flags.\n", unknown_type );
+		printf( "\n\n" );
+	}
 	
-	farfree( coff_symbols );
-	farfree( coff_symbol_name_strings );
+	free( dup );
+	sym_table_free( &table );
+	return(0);
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-int show_bsd_symbol_type( int32_t value, char *str, int symtype, int other, int description )
+/* Start a line of the BSD/COFF symbol listing, up to the description. */
+
+static void bsd_symbol_start( int32_t value, const char *sep, const char *str )
+{
+	out_bytes( "0x", 2 );
+	out_hex( (uint32_t)value, 8 );
+	out_str( sep );
+	out_pad( str, 35 );
+	out_bytes( "  ", 2 );
+}
+
+static void bsd_symbol_line( int32_t value, const char *sep, const char *str, const char *desc )
+{
+	bsd_symbol_start( value, sep, str );
+	out_str( desc );
+	out_eol();
+}
+
+int show_bsd_symbol_type( int32_t value, const char *str, int symtype, int description )
 {
-	char *symDesc;
+	const char *symDesc;
 
 	switch( symtype )
 	{
@@ -639,93 +468,109 @@ int show_bsd_symbol_type( int32_t value, char *str, int symtype, int other, int
 			if (str && (symDesc = strchr(str, ':')) && *++symDesc) {
 				if ((symDesc[0] >= '0' && symDesc[0] <= '9') ||
 				    symDesc[0] == '(' || symDesc[0] == '-') {
-					printf( "0x%08" PRIx32 "  %-35s  Local Variable\n", value, str);
+					bsd_symbol_line( value, "  ", str, "Local Variable" );
 				} else {
 					/* Type definition */
-					printf( "0x%08" PRIx32 "  %-35s  Type Definition\n", value, str);
+					bsd_symbol_line( value, "  ", str, "Type Definition" );
 				}
 				return 1;
 			}
 			/* Malformed stabs data. Fall through */
 		case 0xA0:
 		case 0x40:
-			printf( "0x%08" PRIx32 "  %-35s  Unknown Type: 0x%02x\n", value, " " /*str*/, symtype );
+			bsd_symbol_start( value, "  ", " " /*str*/ );
+			out_bytes( "Unknown Type: 0x", 16 );
+			out_hex( symtype, 2 );
+			out_eol();
 			return(1);
 		case 0x3c:
-			printf( "0x%08" PRIx32 "  %-35s  Debugger option\n", value, str);
+			bsd_symbol_line( value, "  ", str, "Debugger option" );
 			return 1;
 		case 0x20:
-			printf( "0x%08" PRIx32 "  %-35s  Global\n", value, str );
+			bsd_symbol_line( value, "  ", str, "Global" );
 			break;
 		case 0x24:
-			printf( "0x%08" PRIx32 "  %-35s  Function\n", value, str );
+			bsd_symbol_line( value, "  ", str, "Function" );
 			break;
 		case 0xC0:
-			printf( "0x%08" PRIx32 "  %-35s  Left bracket/open block\n", value, str );
+			bsd_symbol_line( value, "  ", str, "Left bracket/open block" );
 			return 1;
 		case 0xE0:
-			printf( "0x%08" PRIx32 "  %-35s  Right bracket/close block\n", value, str );
+			bsd_symbol_line( value, "  ", str, "Right bracket/close block" );
 			return 1;
 		case 0xE2:
-			printf( "0x%08" PRIx32 "  %-35s  Begin common block\n", value, str );
+			bsd_symbol_line( value, "  ", str, "Begin common block" );
 			return 1;
 		case 0xE4:
-			printf( "0x%08" PRIx32 "  %-35s  End common block\n", value, str );
+			bsd_symbol_line( value, "  ", str, "End common block" );
 			return 1;
 		case 0x64:
-			printf( "0x%08" PRIx32 "  %-35s  Primary Source Code File\n", value, str );
+			bsd_symbol_line( value, "  ", str, "Primary Source Code File" );
 			return 1;
 		case 0x84:
-			printf( "0x%08" PRIx32 "  %-35s  Included Source Code File\n", value, str );
+			bsd_symbol_line( value, "  ", str, "Included Source Code File" );
 			return 1;
 /********/
 		case 0x44:
 			if( ! opt_skip_line_numbers )
-			  printf( "0x%08" PRIx32 "  %-35s  Text Line Number: %d\n", value, str, description );
+			{
+				bsd_symbol_start( value, "  ", str );
+				out_str( "Text Line Number: " );
+				out_dec( description );
+				out_eol();
+			}
 			return 1;
 		case 0x48:
 			if( ! opt_skip_line_numbers )
-			  printf( "0x%08" PRIx32 "  %-35s  BSS Line Number\n", value, " " );
+			  bsd_symbol_line( value, "  ", " ", "BSS Line Number" );
 			return 1;
 		case 0x4C:
 			if( ! opt_skip_line_numbers )
-			  printf( "0x%08" PRIx32 "  %-35s  GPU/DSP Line Number: %d\n", value, str, description );
+			{
+				bsd_symbol_start( value, "  ", str );
+				out_str( "GPU/DSP Line Number: " );
+				out_dec( description );
+				out_eol();
+			}
 			return 1;
 /********/
 		case 0x09:
-			printf( "0x%08" PRIx32 " %-35s  Global BSS\n", value, str );
+			bsd_symbol_line( value, " ", str, "Global BSS" );
 			break;
 		case 0x08:
-			printf( "0x%08" PRIx32 " %-35s  BSS\n", value, str );
+			bsd_symbol_line( value, " ", str, "BSS" );
 			break;
 /********/
 		case 0x07:
-			printf( "0x%08" PRIx32 "  %-35s  Global Data\n", value, str );
+			bsd_symbol_line( value, "  ", str, "Global Data" );
 			break;
 		case 0x06:
-			printf( "0x%08" PRIx32 "  %-35s  Data\n", value, str );
+			bsd_symbol_line( value, "  ", str, "Data" );
 			break;
 /********/
 		case 0x05:
-			printf( "0x%08" PRIx32 "  %-35s  Global Text\n", value, str );
+			bsd_symbol_line( value, "  ", str, "Global Text" );
 			break;
 		case 0x04:
-			printf( "0x%08" PRIx32 "  %-35s  Text\n", value, str );
+			bsd_symbol_line( value, "  ", str, "Text" );
 			break;
 /********/
 		case 0x03:
-			printf( "0x%08" PRIx32 "  %-35s  Global Equate or GPU/DSP Text\n", value, str );
+			bsd_symbol_line( value, "  ", str, "Global Equate or GPU/DSP Text" );
 			break;
 		case 0x02:
-			printf( "0x%08" PRIx32 "  %-35s  Equate or GPU/DSP Text\n", value, str );
+			bsd_symbol_line( value, "  ", str, "Equate or GPU/DSP Text" );
 			break;
 
 		case 0x01:
-			printf( "0x%08" PRIx32 "  %-35s  Global (Undefined Segment)\n", value, str );
+			bsd_symbol_line( value, "  ", str, "Global (Undefined Segment)" );
 			break;
 /********/
 		default:
-			printf( "0x%08" PRIx32 "  %-35s  Unknown Type: 0x%02x\n", value, str, symtype );
+			bsd_symbol_start( value, "  ", str );
+			out_bytes( "Unknown Type: 0x", 16 );
+			out_hex( symtype, 2 );
+			out_eol();
 			return(1);
 	}
 	return(0);
@@ -737,21 +582,35 @@ int show_bsd_symbol_type( int32_t value, char *str, int symtype, int other, int
 
 void usage(void)
 {
-	printf( "Usage:\n\tSIZE [-sd] [-v[0|1|2]] [-l] <filename>\n\n");
+	printf( "SIZE: Version %d.%02d\n\n", MAJOR_VERSION, MINOR_VERSION );
+	printf( "Usage:\n\tSIZE [-sd|-u] [-v[0|1|2]] [-l] [-j<n>] [-P<n>] [--summary]\n\t     [--format=<fmt>] <filename>...\n\n");
 	printf( "\t-s  = Show list of all symbols in file\n\n" );
 	printf( "\t-sd = Don't skip duplicate symbol names in listing\n\n" );
+	printf( "\t-u  = Show symbols, skipping any with the same name and value\n" );
+	printf( "\t      as one already shown, in any sort order\n\n" );
 
 	printf( "\t-v0 = Don't sort symbols at all\n" );
 	printf( "\t-v1 = Sort symbols by name (default)\n" );
 	printf( "\t-v2 = Sort symbols by value\n\n" );
 
 	printf( "\t-l  = Skip special BSD debugging info line number symbols\n\n" );
+
+	printf( "\t-j<n> = Use <n> threads to sort large symbol tables (default 1)\n\n" );
+
+	printf( "\t-P<n> = Work on <n> of the files at once (default: one per\n" );
+	printf( "\t      processor).  The output comes out in the order they're given.\n\n" );
+
+	printf( "\t--summary = Just print a table of the sizes of all the files\n\n" );
+
+	printf( "\t--format=<fmt> = List the symbols, and nothing else, as text\n" );
+	printf( "\t      (default), jsonl, csv or bin\n\n" );
 	
 	printf( "\t<filename> = a DRI or BSD/COFF format absolute-position\n" );
 	printf( "\texecutable file or DRI/Alcyon format object file.\n" );
 	printf( "\tA filename extension of .ABS or .COF is assumed if none is\n" );
 	printf( "\tspecified.  (i.e. SIZE testprog will look for <testprog> then\n" );
-	printf( "\t<testprog.cof> then <testprog.abs> before giving up.\n\n" );
+	printf( "\t<testprog.cof> then <testprog.abs> before giving up.)  A\n" );
+	printf( "\t<filename> of - reads the file from stdin.\n\n" );
 
 	printf( "For Example:\n\n" );
 	printf( "\tSIZE program     << finds 'program', 'program.cof', or 'program.abs'\n" );
@@ -762,14 +621,39 @@ void usage(void)
 /**************************************************************************/
 /**************************************************************************/
 
-void main( int argc, char *argv[] )
+/* Open <filename> (trying .cof then .abs after it, if it has no */
+/* extension) and do everything asked for with it. */
+
+static int size_file( char *filename )
 {
-int in_handle;
-short has_period;
-char infile[256], *ptr, *filename = NULL;
-int argument;
+OBJ_FILE obj;
+int err;
 
-	printf( "SIZE: Version %d.%02d\n\n", MAJOR_VERSION, MINOR_VERSION );
+	if( file_count > 1 && ! show_summary )
+	  printf( "%s:\n\n", filename );
+
+	if( ( err = obj_open( &obj, filename ) ) < 0 )
+	{
+		obj_perror( stdout, &obj, err, filename );
+		return ( err == OBJ_WRONG_TYPE ) ? 1 : -1;
+	}
+
+	err = process_abs_file( &obj );
+	obj_close( &obj );
+
+	if( err == 0 && file_count > 1 && ! show_summary )
+	  printf( "\n" );
+	return(err);
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+void main( int argc, char *argv[] )
+{
+char **files;
+int argument, jobs = 0;
 
 	if(argc < 2)
 	{
@@ -781,15 +665,22 @@ int argument;
 	
 	sort_options = SORT_BY_NAME;	/* Sort symbols by name */
 
+	files = malloc( argc * sizeof(char *) );
+	if( ! files )
+	{
+		printf( "Cannot allocate memory for the file list!\n" );
+		exit(-1);
+	}
+
 /* Parse command line arguments */
 
 	for( argument = 1; argument < argc; argument++ )
 	{
 //		printf( "Processing argument %d: '%s'\n", argument, argv[argument] );
 
-		if( argv[argument][0] != '-' && argv[argument][0] )
+		if( ( argv[argument][0] != '-' || ! argv[argument][1] ) && argv[argument][0] )
 		{
-			filename = argv[argument];
+			files[file_count++] = argv[argument];
 		}
 		else if( ! strcmp( "-s", argv[argument] ) )
 		{
@@ -806,6 +697,11 @@ int argument;
 			show_symbols = 1;		/* Show symbols */
 			skip_duplicates = 0;		/* but don't skip duplicate names */
 		}
+		else if( ! strcmp( "-u", argv[argument] ) )
+		{
+			show_symbols = 1;		/* Show symbols */
+			unique_symbols = 1;		/* skipping repeated names and values in any order */
+		}
 		else if( ! strcmp( "-l", argv[argument] ) )	/* Same as -sd */
 		{
 			opt_skip_line_numbers = 1;
@@ -828,6 +724,41 @@ int argument;
 		{
 			sort_options = SORT_BY_VALUE;	/* Sort symbols by value */
 		}
+		else if( ! strncmp( "-j", argv[argument], 2 ) )
+		{
+		int threads = atoi( argv[argument] + 2 );
+
+			if( threads < 1 || threads > SYM_SORT_MAX_THREADS )
+			{
+				usage();
+				exit(-1);
+			}
+			sym_sort_threads( threads );
+		}
+		else if( ! strncmp( "-P", argv[argument], 2 ) )
+		{
+			jobs = atoi( argv[argument] + 2 );
+			if( jobs < 1 || jobs > BATCH_MAX_JOBS )
+			{
+				usage();
+				exit(-1);
+			}
+		}
+		else if( ! strcmp( "--summary", argv[argument] ) )
+		{
+			show_summary = 1;
+		}
+		else if( ! strncmp( "--format=", argv[argument], 9 ) )
+		{
+			out_format = sym_format_parse( argv[argument] + 9 );
+			if( out_format < 0 )
+			{
+				usage();
+				exit(-1);
+			}
+			if( out_format != SYM_FORMAT_TEXT )
+			  show_symbols = 1;		/* Nothing else to put in it */
+		}
 		else if( strncmp( "-", argv[argument], 1 ) ) /* unrecognized switch */
 		{
 			usage();
@@ -842,58 +773,44 @@ int argument;
 #endif
 	}
 
-	if (!filename)
+	if( ! file_count )
 	{
 		usage();
 		exit(-1);
 	}
 
-/* If you don't sort by name (sort by value), then don't skip duplicate symbols. */
+/* The machine readable listings are the only thing on stdout, and */
+/* each one is a whole file of its own. */
 
-	if( sort_options != SORT_BY_NAME )
-	  skip_duplicates = 0;
-	
-/*	Look for FILENAME.EXT (exactly as given on commandline), if that's
-	not found, and filename specified has no extension, then look
-	for FILENAME.COF, and FILENAME.ABS, and do it in that order. */
-
-	strncpy( infile, filename, 255 );
-	has_period = (strchr(infile,'.') != NULL) ? 1 : 0;
-
-	in_handle = Fopen( infile, FO_BINARY );
-	if( in_handle < 0 )
+	if( out_format != SYM_FORMAT_TEXT && ( file_count > 1 || show_summary ) )
 	{
-		/* If there's an extension specified in the input filename, */
-		/* then show the FILE NOT FOUND error message and exit. */
+		fprintf( stderr, "Only one file can be listed with --format=, and not with --summary\n" );
+		exit(-1);
+	}
 
-		if( has_period )
-		{
-			printf( "Input file '%s' not found!\n", filename );
-			exit(-1);
-		}
+	if( out_format != SYM_FORMAT_TEXT || show_summary )
+	  show_info = 0;
 
-		/* No filename extension was originally specified, so let's try .COF first. */
+	if( out_format == SYM_FORMAT_TEXT )
+	  printf( "SIZE: Version %d.%02d\n\n", MAJOR_VERSION, MINOR_VERSION );
 
-		strcat(infile,".cof");
+	if( show_summary )
+	  printf( "   text    data     bss     dec     hex filename\n" );
 
-		in_handle = Fopen( infile, FO_BINARY );
-		if( in_handle < 0 )
-		{
-			/* file.COF not found, so try .ABS extension */
+	if( ! jobs )
+	  jobs = batch_jobs_default();
 
-			if((ptr = strchr(infile,'.')) != NULL)
-			  *ptr=0;
-			strcat(infile,".abs");
+/* If you don't sort by name (sort by value), then don't skip duplicate symbols, */
+/* unless -u asked for repeats to be skipped whatever the order. */
 
-			if((in_handle = Fopen( infile, FO_BINARY )) < 0)
-			{
-				printf("Error: Can't open inputfile: %s\n",filename);
-				exit(-1);
-			}
-		}
-	}
-	process_abs_file(infile, in_handle);
-	Fclose(in_handle);
-	exit(0);
+	if( unique_symbols )
+	  skip_duplicates = 1;
+	else if( sort_options != SORT_BY_NAME )
+	  skip_duplicates = 0;
+	
+	if( file_count == 1 )
+	  exit( size_file( files[0] ) );
+
+	exit( batch_run( file_count, files, jobs, size_file ) ? 1 : 0 );
 }
 
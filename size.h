@@ -61,6 +61,13 @@ typedef struct
 	+ sizeof(int32_t) /* dbase */ \
 	+ sizeof(int32_t) /* bbase */)
 
+/* What filefix puts in res1 of a .sym file whose symbols are sorted by */
+/* name (as 8 unsigned bytes) and then value, with no repeats and just */
+/* zeros after the end of each name, so a name can be found in it with */
+/* a binary search.  It's "SORT". */
+
+#define DRI_SORTED_SYMS	(0x534f5254L)
+
 typedef struct
 {
 	int16_t	magic;		/* Should be 0x0150 */
@@ -197,4 +204,228 @@ typedef struct
 	+ sizeof(int32_t) /* trsize */ \
 	+ sizeof(int32_t) /* drsize */ )
 
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+typedef struct
+{
+	int		fhand;		/* Handle the file was opened with */
+	const uint8_t	*data;		/* Whole file if mapped, else the window */
+	uint8_t		*buf;		/* Window buffer when not mapped */
+	off_t		size;		/* File size, or -1 if unknown (pipe) */
+	off_t		pos;		/* Current read position */
+	off_t		base;		/* File offset of data[0] */
+	size_t		len;		/* Number of valid bytes at data */
+	size_t		bufsize;	/* Allocated size of buf */
+	short		mapped;		/* File is memory mapped */
+	short		seekable;	/* File can be re-read at any offset */
+} IN_FILE;
+
+#define IN_COPY_OK	(0)		/* in_copy() results */
+#define IN_COPY_SHORT	(-1)		/* Input ended early */
+#define IN_COPY_FAILED	(-2)		/* Output couldn't be written */
+
+/* Returns the name of symbol <sym> in <table>, and its length in <len>. */
+/* The name doesn't need to be NUL terminated.  sym_hash_build() leaves */
+/* out any symbol it returns NULL for. */
+
+typedef const char *(*SYM_NAME_FN)( const void *table, uint32_t sym, size_t *len );
+
+typedef struct
+{
+	uint32_t	*slots;		/* First symbol with each name, plus 1 (0 = empty) */
+	uint32_t	*hashes;	/* Hash of the name in each slot */
+	uint32_t	*next;		/* Next symbol with the same name, in file order */
+	uint32_t	mask;		/* Number of slots - 1 */
+	SYM_NAME_FN	name_fn;
+	const void	*table;
+} SYM_HASH;
+
+#define SYM_NONE	(0xffffffffUL)
+
+/* Returns the value of symbol <sym> in <table>. */
+
+typedef uint32_t (*SYM_VALUE_FN)( const void *table, uint32_t sym );
+
+/* Layout of a symbol index file written by symcache.c.  The header is */
+/* followed by num_slots hash slots, count entries sorted by name, and */
+/* strings_size bytes of names. */
+
+typedef struct
+{
+	char		magic[8];
+	uint32_t	byte_order;	/* 0x01020304 as written */
+	uint32_t	flags;		/* SYM_CACHE_xxx */
+	uint64_t	file_size;	/* Input file this index was built from */
+	int64_t		file_mtime;
+	uint64_t	file_ino;
+	uint64_t	file_hash;	/* Of its headers and symbol tables */
+	uint32_t	file_mtime_nsec;
+	uint32_t	count;		/* Number of entries */
+	uint32_t	num_slots;	/* Number of hash slots, a power of 2 */
+	uint32_t	strings_size;	/* Bytes of names */
+} SYM_CACHE_HDR;
+
+#define SYM_CACHE_DRI_NAMES	(0x0001)	/* Names are DRI, 8 chars max */
+
+typedef struct
+{
+	uint32_t	hash;		/* sym_hash_string() of the name */
+	uint32_t	value;
+	uint32_t	name;		/* Offset of the name in the strings */
+	uint32_t	len;		/* Length of the name */
+} SYM_CACHE_ENTRY;
+
+typedef struct
+{
+	int			fhand;
+	IN_FILE			file;
+	const SYM_CACHE_HDR	*hdr;
+	const uint32_t		*slots;		/* First entry with each name, plus 1 */
+	const SYM_CACHE_ENTRY	*entries;
+	const char		*strings;
+} SYM_CACHE;
+
+/* Symbol table loaded by symtab.c, a column per field, so that a pass */
+/* over the symbols only touches the fields it uses.  Values are in the */
+/* native byte order, and each name is a NUL terminated string in one */
+/* pool: the 8 name bytes of a DRI symbol, or COFF's own string table. */
+/* A COFF string table is used where it is in a mapped file, so its */
+/* names are only good until the file is closed. */
+
+typedef struct
+{
+	uint32_t	count;
+	uint32_t	*values;
+	uint16_t	*types;		/* DRI type word, or COFF type byte */
+	uint16_t	*descs;		/* COFF description, 0 for DRI */
+	uint32_t	*names;		/* Offset of each name in the pool */
+	char		*pool;
+	uint32_t	pool_size;
+	short		pool_mapped;	/* pool is part of the input file's mapping */
+	short		dri_names;	/* Names are all 8 bytes of a DRI name */
+} SYM_TABLE;
+
+#define SYM_TABLE_OK		(0)	/* sym_table_read_xxx() results */
+#define SYM_TABLE_NO_MEMORY	(-1)
+#define SYM_TABLE_SHORT		(-2)	/* Symbol table ended early */
+
+/* An executable or object file opened by objfile.c, with everything */
+/* read from its headers.  Nothing about it is kept anywhere else, so */
+/* any number can be open at once. */
+
+#define OBJ_DRI_ABS		(1)	/* Kinds of file, in obj->kind */
+#define OBJ_DRI_OBJECT		(2)
+#define OBJ_COFF		(3)
+#define OBJ_BSD			(4)
+
+#define OBJ_OK			(0)	/* obj_xxx() results */
+#define OBJ_NOT_FOUND		(-1)	/* The file named isn't there */
+#define OBJ_CANT_OPEN		(-2)	/* Nor is it with .cof or .abs after it */
+#define OBJ_CANT_READ		(-3)
+#define OBJ_WRONG_TYPE		(-4)	/* Unknown magic number */
+#define OBJ_NO_MEMORY		(-5)
+#define OBJ_SHORT		(-6)	/* Symbol table ended early */
+
+typedef struct
+{
+	int		fhand;
+	IN_FILE		in;
+	short		kind;		/* OBJ_DRI_ABS etc */
+	char		name[256];	/* The file that was actually opened */
+	ABS_HDR		header;		/* Filled in from the section headers for COFF */
+	COF_HDR		coff_header;	/* Filled in from the BSD header for BSD */
+	RUN_HDR		run_header;
+	SEC_HDR		txt_header, dta_header, bss_header;
+	BSD_Object	bsd_object;
+} OBJ_FILE;
+
+/* Machine readable listings written by symout.c, for --format= */
+
+#define SYM_FORMAT_TEXT		(0)
+#define SYM_FORMAT_JSONL	(1)
+#define SYM_FORMAT_CSV		(2)
+#define SYM_FORMAT_BIN		(3)
+
+/* A --format=bin listing is a record per symbol, the pool of NUL */
+/* terminated names they point into, and a trailer, all little-endian. */
+
+typedef struct
+{
+	uint32_t	name;		/* Offset of the name in the pool */
+	uint32_t	len;		/* Length of the name */
+	uint32_t	value;
+	uint32_t	type;		/* DRI type word, or COFF type byte */
+} SYM_BIN_RECORD;
+#define PACKED_SIZE_SYM_BIN_RECORD ( \
+	sizeof(uint32_t) /* name */ \
+	+ sizeof(uint32_t) /* len */ \
+	+ sizeof(uint32_t) /* value */ \
+	+ sizeof(uint32_t) /* type */ )
+
+typedef struct
+{
+	uint32_t	count;		/* Number of records */
+	uint32_t	pool_size;	/* Bytes of names */
+	char		magic[8];	/* SYM_BIN_MAGIC */
+} SYM_BIN_TRAILER;
+#define PACKED_SIZE_SYM_BIN_TRAILER ( \
+	sizeof(uint32_t) /* count */ \
+	+ sizeof(uint32_t) /* pool_size */ \
+	+ (sizeof(char)*8) /* magic */ )
+
+#define SYM_BIN_MAGIC		"JAGSYMB1"
+
+/* A listing being written by symout.c.  The caller owns it, and it's */
+/* only looked at through sym_write_begin(), _symbol() and _end(). */
+
+typedef struct
+{
+	int		format;		/* SYM_FORMAT_xxx */
+	uint32_t	count;		/* Symbols so far */
+	char		*records;	/* Records for the bin format */
+	uint32_t	records_alloc;
+	char		*pool;		/* and their names */
+	uint32_t	pool_size, pool_alloc;
+} SYM_WRITER;
+
+/* Address to symbol index built by symaddr.c */
+
+#define SYM_ADDR_BATCH	(16)		/* Searches sym_addr_find_batch() steps together */
+
+typedef struct
+{
+	uint32_t	value;
+	uint32_t	sym;		/* Index of the symbol in its table */
+} SYM_ADDR_ENTRY;
+
+typedef struct
+{
+	SYM_ADDR_ENTRY	*entries;	/* Sorted by value, one per address */
+	uint32_t	*tree;		/* Values in Eytzinger order, from [1] */
+	uint32_t	*rank;		/* Position in entries[] of each tree[] value */
+	uint32_t	count;
+} SYM_ADDR;
+
+/* Sort key for symsort.c, pulled out of record <index> */
+
+#define SYM_SORT_MAX_THREADS	(64)
+
+#define SYM_SORT_VALUE		(0x0001)	/* Fields filled in for sym_sort_keys() */
+#define SYM_SORT_PREFIX		(0x0002)
+
+typedef struct
+{
+	uint64_t	prefix;		/* First 8 bytes of the name, big-endian */
+	uint32_t	value;		/* Breaks ties between equal prefixes */
+	uint32_t	index;
+} SYM_SORT_KEY;
+
+/* Running a tool over a list of files, for batch.c */
+
+#define BATCH_MAX_JOBS		(64)
+
+typedef int (*BATCH_FN)( char *filename );	/* Returns the exit status */
+
 #endif /* __FILEFIX_H_ */
@@ -0,0 +1,185 @@
+/*
+	symaddr.c
+
+	Address to symbol index.  Takes the (value, symbol) pairs of the
+	symbols that name addresses, sorts them by value once, and then
+	finds the symbol at or below any address with a branch-free walk
+	down an implicit search tree.
+
+	The values are stored in Eytzinger (breadth first) order, so the
+	first few levels of every search share the same couple of cache
+	lines and the rest touch one line per level, instead of the
+	scattered accesses of a plain binary search over a large array.
+*/
+
+#include "size.h"
+#include "proto.h"
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+static int sym_addr_compare( const void *a, const void *b )
+{
+const SYM_ADDR_ENTRY *ea = a, *eb = b;
+
+	if ( ea->value != eb->value )
+		return ( ea->value < eb->value ) ? -1 : 1;
+
+	return ( ea->sym < eb->sym ) ? -1 : ( ea->sym > eb->sym );
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Lay out sorted[] in Eytzinger order: an in-order walk of the implicit */
+/* tree rooted at slot <k> visits the sorted values in order. */
+
+static uint32_t sym_addr_layout( SYM_ADDR *index, uint32_t next, uint32_t k )
+{
+	if ( k <= index->count )
+	{
+		next = sym_addr_layout( index, next, 2 * k );
+		index->tree[k] = index->entries[next].value;
+		index->rank[k] = next++;
+		next = sym_addr_layout( index, next, 2 * k + 1 );
+	}
+	return next;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Build the index from <count> entries, which it takes ownership of. */
+/* Where several symbols share an address, the first one in the file is */
+/* kept.  Returns 0 on success, or -1 if there wasn't enough memory. */
+
+int sym_addr_build( SYM_ADDR *index, SYM_ADDR_ENTRY *entries, uint32_t count )
+{
+uint32_t i, kept;
+
+	my_qsort( entries, count, sizeof(SYM_ADDR_ENTRY), sym_addr_compare );
+
+	for ( i = kept = 0; i < count; i++ )
+	{
+		if ( kept && entries[kept - 1].value == entries[i].value )
+			continue;
+		entries[kept++] = entries[i];
+	}
+
+	index->entries = entries;
+	index->count = kept;
+	index->tree = malloc( ( kept + 1 ) * sizeof(uint32_t) );
+	index->rank = malloc( ( kept + 1 ) * sizeof(uint32_t) );
+
+	if ( !index->tree || !index->rank )
+	{
+		sym_addr_free( index );
+		return -1;
+	}
+
+	sym_addr_layout( index, 0, 1 );
+	return 0;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+void sym_addr_free( SYM_ADDR *index )
+{
+	free( index->entries );
+	free( index->tree );
+	free( index->rank );
+	index->entries = NULL;
+	index->tree = index->rank = NULL;
+	index->count = 0;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Turn the slot a search walked off the bottom of the tree at into the */
+/* entry with the highest value <= the address searched for. */
+
+static const SYM_ADDR_ENTRY *sym_addr_result( const SYM_ADDR *index, uint32_t k )
+{
+/* Backing up past the right turns we took leaves k on the first value */
+/* above the address (or at 0 if there isn't one), and the entry we want */
+/* is the one before that. */
+
+	while ( k & 1 )
+		k >>= 1;
+	k >>= 1;
+
+	if ( k == 0 )
+		return index->count ? &index->entries[index->count - 1] : NULL;
+
+	if ( index->rank[k] == 0 )
+		return NULL;
+
+	return &index->entries[index->rank[k] - 1];
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Returns the entry with the highest value <= <addr>, or NULL if <addr> */
+/* is below every symbol. */
+
+const SYM_ADDR_ENTRY *sym_addr_find( const SYM_ADDR *index, uint32_t addr )
+{
+uint32_t k = 1;
+
+	while ( k <= index->count )
+		k = 2 * k + ( index->tree[k] <= addr );
+
+	return sym_addr_result( index, k );
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Look up <count> addresses at once, storing what sym_addr_find() would */
+/* have returned for each in <results>.  The searches are stepped down */
+/* the tree together, a level at a time, so the cache misses of one */
+/* search overlap with those of the others instead of each being waited */
+/* out in turn. */
+
+void sym_addr_find_batch( const SYM_ADDR *index, const uint32_t *addrs,
+			  uint32_t count, const SYM_ADDR_ENTRY **results )
+{
+uint32_t k[SYM_ADDR_BATCH];
+uint32_t i, j, n, depth, level;
+
+	for ( depth = 0; ( 1UL << depth ) <= index->count; depth++ )
+		;
+
+	for ( i = 0; i < count; i += n )
+	{
+		n = ( count - i < SYM_ADDR_BATCH ) ? count - i : SYM_ADDR_BATCH;
+
+		for ( j = 0; j < n; j++ )
+			k[j] = 1;
+
+/* Every search passes the same number of levels, give or take the */
+/* last, partly filled one. */
+
+		for ( level = 0; level < depth; level++ )
+		{
+			for ( j = 0; j < n; j++ )
+			{
+				if ( k[j] <= index->count )
+					k[j] = 2 * k[j] + ( index->tree[k[j]] <= addrs[i + j] );
+			}
+		}
+
+		for ( j = 0; j < n; j++ )
+			results[i + j] = sym_addr_result( index, k[j] );
+	}
+}
@@ -0,0 +1,346 @@
+/*
+	symcache.c
+
+	Persistent symbol index kept in a file next to the input file,
+	so that repeated lookups against the same executable don't have
+	to read and parse its whole symbol table every time.
+
+	The index file holds a header identifying the input file it was
+	built from (size, inode, modification time to the nanosecond, and
+	a hash of its headers), an open-addressed hash table, the symbol
+	entries sorted by name, and a pool of NUL terminated names.  It's
+	written in the native byte order and used in place, so a lookup
+	only touches the pages holding the header, one or two slots, the
+	matching entries and their names, and none of the input file's
+	symbols.  An index built on a machine with a different byte order
+	is treated as stale.
+*/
+
+#include "size.h"
+#include "proto.h"
+
+#ifdef _WIN32
+#include <process.h>		/* for getpid() */
+#endif
+
+#define SYM_CACHE_MAGIC		"JAGSYMX2"
+#define SYM_CACHE_BYTE_ORDER	(0x01020304UL)
+#define SYM_CACHE_SAMPLE	(4096)		/* Bytes of headers hashed */
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Add <len> bytes at <data> to the running hash <h>, eight at a time. */
+/* The index is only used on a machine with the same byte order as the */
+/* one that wrote it, so the words can be loaded in the native order. */
+
+static uint64_t sym_cache_hash( uint64_t h, const uint8_t *data, size_t len )
+{
+uint64_t word;
+
+	for ( ; len >= 8; data += 8, len -= 8 )
+	{
+		memcpy( &word, data, 8 );
+		h = ( h ^ word ) * 0x100000001b3ULL;	/* FNV-1a prime */
+		h ^= h >> 29;
+	}
+	while ( len-- )
+		h = ( h ^ *data++ ) * 0x100000001b3ULL;
+	return h;
+}
+
+/* Work out the key that ties an index to the current contents of */
+/* the input file, whose symbols start at <sym_offset>: its size, inode */
+/* and modification time, which changes whenever the file is written, */
+/* and a hash of the headers before the symbols (up to SYM_CACHE_SAMPLE */
+/* bytes), which say where they are and how many there are.  The */
+/* symbols themselves aren't hashed, as that would read every page of */
+/* them on every lookup.  Without nanosecond time stamps (_WIN32, */
+/* MSDOS) a rewrite in the same second that keeps the size and headers */
+/* isn't noticed.  Leaves the file positioned at the start. */
+
+static int sym_cache_key( IN_FILE *in, off_t sym_offset, SYM_CACHE_HDR *hdr )
+{
+struct stat st;
+const uint8_t *ptr;
+off_t sample;
+
+	if ( !in->seekable || fstat( in->fhand, &st ) != 0 )
+		return -1;
+
+	hdr->file_size = (uint64_t)st.st_size;
+	hdr->file_ino = (uint64_t)st.st_ino;
+	hdr->file_mtime = (int64_t)st.st_mtime;
+#if defined(__APPLE__)
+	hdr->file_mtime_nsec = (uint32_t)st.st_mtimespec.tv_nsec;
+#elif !defined(_WIN32) && !defined(__MSDOS__)
+	hdr->file_mtime_nsec = (uint32_t)st.st_mtim.tv_nsec;
+#endif
+
+	if ( sym_offset < 0 || sym_offset > st.st_size )
+		sym_offset = st.st_size;
+	sample = ( sym_offset < SYM_CACHE_SAMPLE ) ? sym_offset : SYM_CACHE_SAMPLE;
+
+	hdr->file_hash = 14695981039346656037ULL;	/* FNV-1a basis */
+	if ( sample > 0 )
+	{
+		in_seek( in, 0 );
+		if ( ( ptr = in_get( in, (size_t)sample ) ) == NULL )
+			return -1;
+		hdr->file_hash = sym_cache_hash( hdr->file_hash, ptr, (size_t)sample );
+	}
+
+	in_seek( in, 0 );
+	return 0;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Map the index file at <path>, and check that it was built from the */
+/* file that's open as <in>, with its symbols at <sym_offset>.  Returns */
+/* 0 if it's usable, or -1 if it's missing or stale and the symbols */
+/* need to be read from <in> instead. */
+
+int sym_cache_open( SYM_CACHE *cache, const char *path, IN_FILE *in, off_t sym_offset )
+{
+SYM_CACHE_HDR key;
+const SYM_CACHE_HDR *hdr;
+const uint8_t *data;
+uint64_t need;
+int fhand;
+
+	memset( cache, 0, sizeof(*cache) );
+	memset( &key, 0, sizeof(key) );
+	cache->fhand = -1;
+
+	if ( sym_cache_key( in, sym_offset, &key ) < 0 )
+		return -1;
+
+	if ( ( fhand = Fopen( path, FO_RDONLY | FO_BINARY ) ) < 0 )
+		return -1;
+
+	cache->fhand = fhand;
+	if ( in_open( &cache->file, fhand ) < 0 || cache->file.size < (off_t)sizeof(*hdr) )
+		goto stale;
+
+	data = in_get( &cache->file, (size_t)cache->file.size );
+	if ( !data )
+		goto stale;
+
+	hdr = (const SYM_CACHE_HDR *)data;
+	if ( memcmp( hdr->magic, SYM_CACHE_MAGIC, sizeof(hdr->magic) ) ||
+	     hdr->byte_order != SYM_CACHE_BYTE_ORDER ||
+	     hdr->file_size != key.file_size ||
+	     hdr->file_ino != key.file_ino ||
+	     hdr->file_mtime != key.file_mtime ||
+	     hdr->file_mtime_nsec != key.file_mtime_nsec ||
+	     hdr->file_hash != key.file_hash ||
+	     hdr->num_slots == 0 || ( hdr->num_slots & ( hdr->num_slots - 1 ) ) )
+		goto stale;
+
+	need = sizeof(*hdr) +
+		(uint64_t)hdr->num_slots * sizeof(uint32_t) +
+		(uint64_t)hdr->count * sizeof(SYM_CACHE_ENTRY) +
+		hdr->strings_size;
+	if ( need != (uint64_t)cache->file.size )
+		goto stale;
+
+	cache->hdr = hdr;
+	cache->slots = (const uint32_t *)( hdr + 1 );
+	cache->entries = (const SYM_CACHE_ENTRY *)( cache->slots + hdr->num_slots );
+	cache->strings = (const char *)( cache->entries + hdr->count );
+	return 0;
+
+stale:
+	sym_cache_close( cache );
+	return -1;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+void sym_cache_close( SYM_CACHE *cache )
+{
+	if ( cache->fhand >= 0 )
+	{
+		in_close( &cache->file );
+		Fclose( cache->fhand );
+	}
+	cache->fhand = -1;
+	cache->hdr = NULL;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Build an index of the <count> symbols in <table>, read from <in> at */
+/* <sym_offset>, and write it to <path>, replacing any stale one. */
+/* <flags> is stored in the index for the caller to check later. */
+/* Returns 0 on success, or -1 if the index couldn't be written, which */
+/* callers are free to ignore. */
+
+int sym_cache_write( const char *path, IN_FILE *in, off_t sym_offset, uint32_t count,
+		     SYM_NAME_FN name_fn, SYM_VALUE_FN value_fn,
+		     const void *table, uint32_t flags )
+{
+SYM_CACHE_HDR hdr;
+SYM_CACHE_ENTRY *entries = NULL;
+SYM_SORT_KEY *order = NULL;
+uint32_t *slots = NULL;
+char *strings = NULL, tmpname[280];
+uint32_t i, slot, num_slots;
+size_t len, strings_size;
+const char *name;
+int out_handle, result = -1;
+
+	memset( &hdr, 0, sizeof(hdr) );
+	if ( count > 0x40000000UL || sym_cache_key( in, sym_offset, &hdr ) < 0 )
+		return -1;
+
+	num_slots = 16;
+	while ( num_slots < count * 2 )
+		num_slots *= 2;
+
+	order = malloc( ( count ? count : 1 ) * sizeof(SYM_SORT_KEY) );
+	entries = malloc( ( count ? count : 1 ) * sizeof(SYM_CACHE_ENTRY) );
+	slots = calloc( num_slots, sizeof(uint32_t) );
+	if ( !order || !entries || !slots )
+		goto done;
+
+/* Sort the symbols by name, keeping symbols with the same name in file */
+/* order, and add up how much room the names need. */
+
+	strings_size = 0;
+	for ( i = 0; i < count; i++ )
+	{
+		name = name_fn( table, i, &len );
+		order[i].prefix = sym_name_prefix( name, len );
+		order[i].value = 0;
+		order[i].index = i;
+		strings_size += len + 1;
+	}
+
+	if ( sym_sort_keys( order, count, SYM_SORT_PREFIX, name_fn, table ) < 0 )
+		goto done;
+
+/* Pad the string pool so the file stays a multiple of 4 bytes long. */
+
+	strings_size = ( strings_size + 3 ) & ~(size_t)3;
+	if ( ( strings = calloc( strings_size ? strings_size : 1, 1 ) ) == NULL )
+		goto done;
+
+/* Fill in the entries, and hash the first entry of each distinct name. */
+
+	strings_size = 0;
+	for ( i = 0; i < count; i++ )
+	{
+		name = name_fn( table, order[i].index, &len );
+		memcpy( strings + strings_size, name, len );
+
+		entries[i].hash = sym_hash_string( name, len );
+		entries[i].value = value_fn( table, order[i].index );
+		entries[i].name = (uint32_t)strings_size;
+		entries[i].len = (uint32_t)len;
+		strings_size += len + 1;
+
+		if ( i > 0 && entries[i].hash == entries[i - 1].hash &&
+		     entries[i].len == entries[i - 1].len &&
+		     !memcmp( strings + entries[i - 1].name, name, len ) )
+			continue;
+
+		for ( slot = entries[i].hash & ( num_slots - 1 ); slots[slot];
+		      slot = ( slot + 1 ) & ( num_slots - 1 ) )
+			;
+		slots[slot] = i + 1;
+	}
+	strings_size = ( strings_size + 3 ) & ~(size_t)3;
+
+	memcpy( hdr.magic, SYM_CACHE_MAGIC, sizeof(hdr.magic) );
+	hdr.byte_order = SYM_CACHE_BYTE_ORDER;
+	hdr.flags = flags;
+	hdr.count = count;
+	hdr.num_slots = num_slots;
+	hdr.strings_size = (uint32_t)strings_size;
+
+/* Write it under a temporary name and then move it into place, so that */
+/* a reader never sees a half written index.  The name has the process */
+/* id in it, as two runs at once (under make -j, say) can be building */
+/* the same index. */
+
+	if ( strlen( path ) + 32 >= sizeof(tmpname) )
+		goto done;
+	sprintf( tmpname, "%s.%ld.tmp", path, (long)getpid() );
+
+	out_handle = Fopen( tmpname, FO_WRONLY | FO_CREATE | FO_BINARY );
+	if ( out_handle < 0 )
+		goto done;
+
+	if ( Fwrite( out_handle, sizeof(hdr), &hdr ) == sizeof(hdr) &&
+	     Fwrite( out_handle, num_slots * sizeof(uint32_t), slots ) == (long)( num_slots * sizeof(uint32_t) ) &&
+	     Fwrite( out_handle, count * sizeof(SYM_CACHE_ENTRY), entries ) == (long)( count * sizeof(SYM_CACHE_ENTRY) ) &&
+	     Fwrite( out_handle, strings_size, strings ) == (long)strings_size )
+	{
+		result = 0;
+	}
+	Fclose( out_handle );
+
+#ifdef _WIN32
+	remove( path );
+#endif
+	if ( result < 0 || rename( tmpname, path ) != 0 )
+	{
+		remove( tmpname );
+		result = -1;
+	}
+
+done:
+	free( order );
+	free( entries );
+	free( slots );
+	free( strings );
+	return result;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Returns the first entry (in file order) named <name>, or SYM_NONE. */
+
+uint32_t sym_cache_find( const SYM_CACHE *cache, const char *name, size_t len )
+{
+const SYM_CACHE_ENTRY *entry;
+uint32_t h, slot, mask;
+
+	h = sym_hash_string( name, len );
+	mask = cache->hdr->num_slots - 1;
+
+	for ( slot = h & mask; cache->slots[slot]; slot = ( slot + 1 ) & mask )
+	{
+		entry = &cache->entries[cache->slots[slot] - 1];
+		if ( entry->hash == h && entry->len == len &&
+		     !memcmp( cache->strings + entry->name, name, len ) )
+			return cache->slots[slot] - 1;
+	}
+
+	return SYM_NONE;
+}
+
+/* Returns the next entry with the same name as <entry>, or SYM_NONE. */
+
+uint32_t sym_cache_next( const SYM_CACHE *cache, uint32_t entry )
+{
+const SYM_CACHE_ENTRY *cur = &cache->entries[entry], *next = cur + 1;
+
+	if ( entry + 1 >= cache->hdr->count || next->hash != cur->hash ||
+	     next->len != cur->len ||
+	     memcmp( cache->strings + next->name, cache->strings + cur->name, cur->len ) )
+		return SYM_NONE;
+
+	return entry + 1;
+}
@@ -0,0 +1,206 @@
+/*
+	symhash.c
+
+	Hash index over the names in a loaded symbol table, so that a
+	list of names can be looked up with one pass over the table
+	instead of one pass per name.
+
+	The table itself isn't touched; the caller supplies a function
+	that returns the name of symbol <n>.  Each slot holds the first
+	symbol (in file order) with a given name, and symbols that share
+	a name are chained together in file order behind it.
+*/
+
+#include "size.h"
+#include "proto.h"
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+uint32_t sym_hash_string( const char *name, size_t len )
+{
+uint32_t hash = 2166136261UL;		/* FNV-1a */
+
+	while ( len-- )
+	{
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619UL;
+	}
+	return hash;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Returns 0 on success, -1 if there wasn't enough memory. */
+
+int sym_hash_build( SYM_HASH *hash, uint32_t count, SYM_NAME_FN name_fn, const void *table )
+{
+uint32_t size, sym, slot, head;
+const char *name, *other;
+size_t len, other_len;
+
+	if ( count > 0x40000000UL )
+		return -1;
+
+	size = 16;
+	while ( size < count * 2 )
+		size *= 2;
+
+	hash->mask = size - 1;
+	hash->name_fn = name_fn;
+	hash->table = table;
+	hash->slots = calloc( size, sizeof(uint32_t) );
+	hash->hashes = malloc( size * sizeof(uint32_t) );
+	hash->next = malloc( ( count ? count : 1 ) * sizeof(uint32_t) );
+
+	if ( !hash->slots || !hash->hashes || !hash->next )
+	{
+		sym_hash_free( hash );
+		return -1;
+	}
+
+/* Insert from the end of the table backwards, pushing each symbol on */
+/* the front of its name's chain, so the chains come out in file order. */
+
+	for ( sym = count; sym-- > 0; )
+	{
+	uint32_t h;
+
+		name = name_fn( table, sym, &len );
+		h = sym_hash_string( name, len );
+
+		for ( slot = h & hash->mask; ( head = hash->slots[slot] ) != 0;
+		      slot = ( slot + 1 ) & hash->mask )
+		{
+			if ( hash->hashes[slot] != h )
+				continue;
+
+			other = name_fn( table, head - 1, &other_len );
+			if ( other_len == len && !memcmp( other, name, len ) )
+				break;
+		}
+
+		hash->next[sym] = head ? head - 1 : SYM_NONE;
+		hash->slots[slot] = sym + 1;
+		hash->hashes[slot] = h;
+	}
+
+	return 0;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+void sym_hash_free( SYM_HASH *hash )
+{
+	free( hash->slots );
+	free( hash->hashes );
+	free( hash->next );
+	hash->slots = hash->hashes = hash->next = NULL;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Returns the first symbol named <name>, or SYM_NONE if there isn't one. */
+/* Use sym_hash_next() to walk through any others with the same name. */
+
+uint32_t sym_hash_find( const SYM_HASH *hash, const char *name, size_t len )
+{
+uint32_t h, slot, head;
+const char *other;
+size_t other_len;
+
+	h = sym_hash_string( name, len );
+
+	for ( slot = h & hash->mask; ( head = hash->slots[slot] ) != 0;
+	      slot = ( slot + 1 ) & hash->mask )
+	{
+		if ( hash->hashes[slot] != h )
+			continue;
+
+		other = hash->name_fn( hash->table, head - 1, &other_len );
+		if ( other_len == len && !memcmp( other, name, len ) )
+			return head - 1;
+	}
+
+	return SYM_NONE;
+}
+
+uint32_t sym_hash_next( const SYM_HASH *hash, uint32_t sym )
+{
+	return hash->next[sym];
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Set dup[i] for each of the <count> symbols with the same name and value */
+/* as an earlier one, so that a listing in any order can skip repeats */
+/* without having to be sorted by name first.  Returns 0 on success, or */
+/* -1 if there wasn't enough memory. */
+
+int sym_hash_mark_repeats( uint32_t count, SYM_NAME_FN name_fn, SYM_VALUE_FN value_fn,
+			   const void *table, uint8_t *dup )
+{
+uint32_t size, mask, sym, slot, head, h, value;
+uint32_t *slots, *hashes;
+const char *name, *other;
+size_t len, other_len;
+
+	if ( count > 0x40000000UL )
+		return -1;
+
+	size = 16;
+	while ( size < count * 2 )
+		size *= 2;
+	mask = size - 1;
+
+	slots = calloc( size, sizeof(uint32_t) );
+	hashes = malloc( size * sizeof(uint32_t) );
+	if ( !slots || !hashes )
+	{
+		free( slots );
+		free( hashes );
+		return -1;
+	}
+
+	for ( sym = 0; sym < count; sym++ )
+	{
+		name = name_fn( table, sym, &len );
+		value = value_fn( table, sym );
+
+		h = ( sym_hash_string( name, len ) ^ value ) * 0x9e3779b1UL;
+		h ^= h >> 16;
+
+		dup[sym] = 0;
+		for ( slot = h & mask; ( head = slots[slot] ) != 0; slot = ( slot + 1 ) & mask )
+		{
+			if ( hashes[slot] != h || value_fn( table, head - 1 ) != value )
+				continue;
+
+			other = name_fn( table, head - 1, &other_len );
+			if ( other_len == len && !memcmp( other, name, len ) )
+			{
+				dup[sym] = 1;
+				break;
+			}
+		}
+
+		if ( !dup[sym] )
+		{
+			slots[slot] = sym + 1;
+			hashes[slot] = h;
+		}
+	}
+
+	free( slots );
+	free( hashes );
+	return 0;
+}
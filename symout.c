@@ -0,0 +1,282 @@
+/*
+	symout.c
+
+	Machine readable symbol listings, for tools that would rather not
+	pick the symbols back out of the human readable text with regular
+	expressions.  The symbols go out through the output buffer in
+	outbuf.c, in one of:
+
+	jsonl	one {"name":"...","value":N,"type":N} object per line.
+		Quotes and backslashes in the name are escaped with a
+		backslash, and control characters and bytes from 0x7f up
+		as \u00XX, taking the name as Latin-1.
+
+	csv	a name,value,type header line, then one line per symbol.
+		A name holding a comma, quote, CR or LF is quoted, with
+		any quotes in it doubled.
+
+	bin	a 16 byte SYM_BIN_RECORD per symbol: the offset of its
+		name in the pool, the name's length, the value and the
+		type, each a 32-bit word.  Then the pool of names, each
+		followed by a NUL, in the same order as the records.
+		Then a 16 byte SYM_BIN_TRAILER: the number of records,
+		the size of the pool, and the 8 bytes "JAGSYMB1".
+		Everything is little-endian, so a reader can map the
+		file and find its way around from the last 16 bytes: the
+		records start at 0, and the pool at 16 times the count.
+
+	Values are printed in decimal.  The type is the DRI symbol type
+	word, or the BSD/COFF type byte, as it is in the file.  jsonl and
+	csv lines go out as each symbol is handed over.  A bin listing is
+	held in memory until sym_write_end(), so that if there isn't the
+	memory for it, sym_write_symbol() can give up having written none
+	of it, and return an error for the tool to report.
+
+	Where a listing is up to is kept in a SYM_WRITER belonging to the
+	caller, not in globals.  What's written still goes through the
+	one output buffer for stdout.
+*/
+
+#include "size.h"
+#include "proto.h"
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Returns the SYM_FORMAT_xxx for a --format= name, or -1. */
+
+int sym_format_parse( const char *name )
+{
+	if ( !strcmp( name, "text" ) )
+		return SYM_FORMAT_TEXT;
+	if ( !strcmp( name, "jsonl" ) )
+		return SYM_FORMAT_JSONL;
+	if ( !strcmp( name, "csv" ) )
+		return SYM_FORMAT_CSV;
+	if ( !strcmp( name, "bin" ) )
+		return SYM_FORMAT_BIN;
+	return -1;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+static void put_le32( uint8_t *ptr, uint32_t val )
+{
+	ptr[0] = (uint8_t)val;
+	ptr[1] = (uint8_t)( val >> 8 );
+	ptr[2] = (uint8_t)( val >> 16 );
+	ptr[3] = (uint8_t)( val >> 24 );
+}
+
+/* Make room for <len> more bytes after the <used> bytes in <*buf>, */
+/* which has <*alloc> bytes, doubling it as often as it takes.  It can't */
+/* grow past what 32-bit offsets can reach.  Returns 0, or -1 if there */
+/* isn't the memory, with <*buf> left as it was. */
+
+static int sym_grow( char **buf, uint32_t *alloc, uint32_t used, size_t len )
+{
+uint32_t size;
+char *grown;
+
+	if ( len <= *alloc - used )
+		return 0;
+
+	size = *alloc ? *alloc : 65536;
+	while ( size && len > size - used )
+		size = ( size & 0x80000000UL ) ? 0 : size * 2;
+
+	if ( !size || ( grown = realloc( *buf, size ) ) == NULL )
+		return -1;
+	*buf = grown;
+	*alloc = size;
+	return 0;
+}
+
+/* Let go of a bin listing. */
+
+static void sym_free_bin( SYM_WRITER *writer )
+{
+	free( writer->records );
+	free( writer->pool );
+	writer->records = NULL;
+	writer->pool = NULL;
+	writer->records_alloc = writer->pool_size = writer->pool_alloc = 0;
+}
+
+/* A name as a JSON string.  Names are just bytes, and DRI ones can be */
+/* anything at all, so quotes, backslashes, control characters and */
+/* anything outside ASCII are escaped, the last taken as Latin-1. */
+
+static void out_json_string( const char *name, size_t len )
+{
+const char *run = name, *end = name + len;
+char esc[6];
+uint8_t c;
+
+	out_bytes( "\"", 1 );
+	for ( ; name < end; name++ )
+	{
+		c = (uint8_t)*name;
+		if ( c >= 0x20 && c < 0x7f && c != '"' && c != '\\' )
+			continue;
+
+		out_bytes( run, name - run );
+		run = name + 1;
+
+		if ( c == '"' || c == '\\' )
+		{
+			esc[0] = '\\';
+			esc[1] = (char)c;
+			out_bytes( esc, 2 );
+		}
+		else
+		{
+			out_bytes( "\\u00", 4 );
+			out_hex( c, 2 );
+		}
+	}
+	out_bytes( run, end - run );
+	out_bytes( "\"", 1 );
+}
+
+/* A name as a CSV field, quoted if it has to be. */
+
+static void out_csv_string( const char *name, size_t len )
+{
+const char *ptr, *end = name + len;
+
+	for ( ptr = name; ptr < end; ptr++ )
+	{
+		if ( *ptr == ',' || *ptr == '"' || *ptr == '\n' || *ptr == '\r' )
+			break;
+	}
+
+	if ( ptr == end )
+	{
+		out_bytes( name, len );
+		return;
+	}
+
+	out_bytes( "\"", 1 );
+	for ( ptr = name; ptr < end; ptr++ )
+	{
+		if ( *ptr == '"' )
+		{
+			out_bytes( name, ptr + 1 - name );
+			name = ptr;
+		}
+	}
+	out_bytes( name, end - name );
+	out_bytes( "\"", 1 );
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Start a listing in <format>, kept track of in <writer>. */
+
+void sym_write_begin( SYM_WRITER *writer, int format )
+{
+	memset( writer, 0, sizeof(*writer) );
+	writer->format = format;
+
+	if ( format == SYM_FORMAT_CSV )
+		out_str( "name,value,type\n" );
+
+#ifdef _WIN32
+	if ( format == SYM_FORMAT_BIN )
+		_setmode( 1, _O_BINARY );
+#endif
+}
+
+/* Add a symbol to the listing.  Returns 0, or -1 if there wasn't the */
+/* memory to hold on to it for a bin listing, in which case none of */
+/* the listing has been written, and sym_write_end() shouldn't be */
+/* called. */
+
+int sym_write_symbol( SYM_WRITER *writer, const char *name, size_t len,
+		      uint32_t value, uint32_t type )
+{
+uint8_t *record;
+uint32_t used;
+
+	switch ( writer->format )
+	{
+	case SYM_FORMAT_JSONL:
+		out_bytes( "{\"name\":", 8 );
+		out_json_string( name, len );
+		out_bytes( ",\"value\":", 9 );
+		out_udec( value );
+		out_bytes( ",\"type\":", 8 );
+		out_udec( type );
+		out_bytes( "}\n", 2 );
+		break;
+
+	case SYM_FORMAT_CSV:
+		out_csv_string( name, len );
+		out_bytes( ",", 1 );
+		out_udec( value );
+		out_bytes( ",", 1 );
+		out_udec( type );
+		out_bytes( "\n", 1 );
+		break;
+
+	case SYM_FORMAT_BIN:
+
+/* Each name is NUL terminated in the pool, after the records. */
+
+		used = writer->count * PACKED_SIZEOF(SYM_BIN_RECORD);
+		if ( writer->count >= 0x10000000UL ||
+		     sym_grow( &writer->records, &writer->records_alloc, used,
+			       PACKED_SIZEOF(SYM_BIN_RECORD) ) < 0 ||
+		     sym_grow( &writer->pool, &writer->pool_alloc, writer->pool_size, len + 1 ) < 0 )
+		{
+			sym_free_bin( writer );
+			writer->format = SYM_FORMAT_TEXT;
+			return -1;
+		}
+
+		record = (uint8_t *)writer->records + used;
+		put_le32( record, writer->pool_size );
+		put_le32( record + 4, (uint32_t)len );
+		put_le32( record + 8, value );
+		put_le32( record + 12, type );
+
+		memcpy( writer->pool + writer->pool_size, name, len );
+		writer->pool[writer->pool_size + len] = 0;
+		writer->pool_size += (uint32_t)len + 1;
+		break;
+	}
+
+	writer->count++;
+	return 0;
+}
+
+/* Finish off the listing. */
+
+void sym_write_end( SYM_WRITER *writer )
+{
+uint8_t trailer[PACKED_SIZEOF(SYM_BIN_TRAILER)];
+
+	if ( writer->format == SYM_FORMAT_BIN )
+	{
+		if ( writer->count )
+		{
+			out_bytes( writer->records, writer->count * PACKED_SIZEOF(SYM_BIN_RECORD) );
+			out_bytes( writer->pool, writer->pool_size );
+		}
+
+		put_le32( trailer, writer->count );
+		put_le32( trailer + 4, writer->pool_size );
+		memcpy( trailer + 8, SYM_BIN_MAGIC, 8 );
+		out_bytes( (const char *)trailer, sizeof(trailer) );
+
+		sym_free_bin( writer );
+	}
+
+	out_flush();
+}
@@ -0,0 +1,725 @@
+/*
+	symsort.c
+
+	Symbol table sorting.  Rather than having qsort() call back into
+	a comparator that digs the sort key out of each record again on
+	every comparison, the keys are pulled out once into an array of
+	SYM_SORT_KEYs.  The keys are sorted, and the records, or each
+	column of a SYM_TABLE, are then moved into the order the sorted
+	keys give.
+
+	A key holds the first 8 bytes of the symbol's name packed into a
+	big-endian integer, so comparing two of them compares the names'
+	prefixes without touching the names themselves, and a 32-bit
+	value that breaks ties between equal prefixes (or is the whole key
+	when sorting by value).  They're sorted with an LSD radix sort a
+	byte at a time, which takes linear time and keeps equal keys in
+	file order, just as the merge sort behind qsort() does.  Only
+	names that are 8 bytes or longer and share their whole prefix
+	need to be looked at again to finish the job.
+
+	Big tables can be sorted with several threads: each sorts a slice
+	of the keys, and the slices are then merged in pairs, with every
+	merge split between the threads.  As every key has a different
+	index, there's only ever one right order, so the result is the
+	same however many threads are used.
+*/
+
+#include "size.h"
+#include "proto.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#define SYM_SORT_PARALLEL_MIN	(65536)	/* Smaller tables aren't worth the threads */
+
+static int sort_threads = 1;
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Pack the first 8 bytes of <name> into an integer that compares the way */
+/* the names do with strcmp(), padding short names with zeroes. */
+
+uint64_t sym_name_prefix( const char *name, size_t len )
+{
+uint64_t prefix = 0;
+size_t i;
+
+	for ( i = 0; i < 8; i++ )
+		prefix = ( prefix << 8 ) | ( ( i < len ) ? (uint8_t)name[i] : 0 );
+	return prefix;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Compare the parts of two names past their (equal) 8 byte prefixes. */
+
+static int sym_name_tail_compare( const SYM_SORT_KEY *a, const SYM_SORT_KEY *b,
+				  SYM_NAME_FN name_fn, const void *table )
+{
+const char *name_a, *name_b;
+size_t len_a, len_b;
+int i;
+
+	name_a = name_fn( table, a->index, &len_a );
+	name_b = name_fn( table, b->index, &len_b );
+
+	i = memcmp( name_a + 8, name_b + 8, ( ( len_a < len_b ) ? len_a : len_b ) - 8 );
+	if ( i )
+		return i;
+	if ( len_a != len_b )
+		return ( len_a < len_b ) ? -1 : 1;
+	return ( a->index < b->index ) ? -1 : ( a->index > b->index );
+}
+
+/* Merge sort keys[0..count-1] by their names' tails. */
+
+static void sym_name_tail_sort( SYM_SORT_KEY *keys, SYM_SORT_KEY *temp, uint32_t count,
+				SYM_NAME_FN name_fn, const void *table )
+{
+uint32_t half, i, j, k;
+
+	if ( count < 2 )
+		return;
+
+	half = count / 2;
+	sym_name_tail_sort( keys, temp, half, name_fn, table );
+	sym_name_tail_sort( keys + half, temp, count - half, name_fn, table );
+
+	memcpy( temp, keys, count * sizeof(SYM_SORT_KEY) );
+	for ( i = k = 0, j = half; i < half && j < count; k++ )
+	{
+		if ( sym_name_tail_compare( &temp[j], &temp[i], name_fn, table ) < 0 )
+			keys[k] = temp[j++];
+		else
+			keys[k] = temp[i++];
+	}
+	while ( i < half )
+		keys[k++] = temp[i++];
+	while ( j < count )
+		keys[k++] = temp[j++];
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Sort <count> keys with one thread.  See sym_sort_keys(). */
+
+static int sym_sort_serial( SYM_SORT_KEY *keys, uint32_t count, int fields,
+			    SYM_NAME_FN name_fn, const void *table )
+{
+uint32_t counts[12][256];
+SYM_SORT_KEY *temp, *from, *to, *swap;
+uint32_t i, run, pos, n;
+int pass, first, last;
+
+#define SORT_DIGIT(k,pass) ( ( (pass) < 4 ) ? \
+	( ( (k).value >> ( (pass) * 8 ) ) & 0xff ) : \
+	(uint32_t)( ( (k).prefix >> ( ( (pass) - 4 ) * 8 ) ) & 0xff ) )
+
+	if ( count < 2 )
+		return 0;
+
+	temp = malloc( count * sizeof(SYM_SORT_KEY) );
+	if ( !temp )
+		return -1;
+
+/* The value's bytes are passes 0-3 and the prefix's are passes 4-11, */
+/* so leave out whichever the caller didn't fill in. */
+
+	first = ( fields & SYM_SORT_VALUE ) ? 0 : 4;
+	last = ( fields & SYM_SORT_PREFIX ) ? 11 : 3;
+
+/* Count every byte of every key in one go. */
+
+	memset( counts, 0, sizeof(counts) );
+	if ( fields == SYM_SORT_VALUE )
+	{
+		for ( i = 0; i < count; i++ )
+		{
+			counts[0][keys[i].value & 0xff]++;
+			counts[1][( keys[i].value >> 8 ) & 0xff]++;
+			counts[2][( keys[i].value >> 16 ) & 0xff]++;
+			counts[3][keys[i].value >> 24]++;
+		}
+	}
+	else
+	{
+		for ( i = 0; i < count; i++ )
+		{
+			for ( pass = first; pass <= last; pass++ )
+				counts[pass][SORT_DIGIT( keys[i], pass )]++;
+		}
+	}
+
+	from = keys;
+	to = temp;
+	for ( pass = first; pass <= last; pass++ )
+	{
+
+/* A byte that's the same in every key wouldn't move anything. */
+
+		if ( counts[pass][SORT_DIGIT( from[0], pass )] == count )
+			continue;
+
+		for ( i = pos = 0; i < 256; i++ )
+		{
+			n = counts[pass][i];
+			counts[pass][i] = pos;
+			pos += n;
+		}
+
+		for ( i = 0; i < count; i++ )
+			to[counts[pass][SORT_DIGIT( from[i], pass )]++] = from[i];
+
+		swap = from;
+		from = to;
+		to = swap;
+	}
+
+	if ( from != keys )
+		memcpy( keys, from, count * sizeof(SYM_SORT_KEY) );
+
+#undef SORT_DIGIT
+
+/* A prefix with no zero in it is the start of a name at least 8 bytes */
+/* long, so the rest of the name still has a say. */
+
+	if ( name_fn && ( fields & SYM_SORT_PREFIX ) )
+	{
+		for ( i = 0; i < count; i += run )
+		{
+			for ( run = 1; i + run < count &&
+			      keys[i + run].prefix == keys[i].prefix &&
+			      keys[i + run].value == keys[i].value; run++ )
+				;
+
+			if ( run > 1 && ( keys[i].prefix & 0xff ) )
+				sym_name_tail_sort( keys + i, temp, run, name_fn, table );
+		}
+	}
+
+	free( temp );
+	return 0;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Set how many threads sorting and duplicate marking may use. */
+
+void sym_sort_threads( int count )
+{
+	if ( count < 1 )
+		count = 1;
+	if ( count > SYM_SORT_MAX_THREADS )
+		count = SYM_SORT_MAX_THREADS;
+	sort_threads = count;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Run fn( arg, part, parts ) for each of <parts> parts at once, one of */
+/* them on the calling thread.  A part that can't get a thread of its */
+/* own is run on the calling thread too. */
+
+typedef void (*SYM_TASK_FN)( void *arg, int part, int parts );
+
+typedef struct
+{
+	SYM_TASK_FN	fn;
+	void		*arg;
+	int		part, parts;
+} SYM_TASK;
+
+#ifdef _WIN32
+static DWORD WINAPI sym_task_thread( LPVOID param )
+#else
+static void *sym_task_thread( void *param )
+#endif
+{
+SYM_TASK *task = param;
+
+	task->fn( task->arg, task->part, task->parts );
+	return 0;
+}
+
+static void sym_run_parallel( SYM_TASK_FN fn, void *arg, int parts )
+{
+SYM_TASK tasks[SYM_SORT_MAX_THREADS];
+int started[SYM_SORT_MAX_THREADS];
+#ifdef _WIN32
+HANDLE threads[SYM_SORT_MAX_THREADS];
+#else
+pthread_t threads[SYM_SORT_MAX_THREADS];
+#endif
+int part;
+
+	for ( part = 1; part < parts; part++ )
+	{
+		tasks[part].fn = fn;
+		tasks[part].arg = arg;
+		tasks[part].part = part;
+		tasks[part].parts = parts;
+#ifdef _WIN32
+		threads[part] = CreateThread( NULL, 0, sym_task_thread, &tasks[part], 0, NULL );
+		started[part] = ( threads[part] != NULL );
+#else
+		started[part] = ( pthread_create( &threads[part], NULL, sym_task_thread, &tasks[part] ) == 0 );
+#endif
+		if ( !started[part] )
+			fn( arg, part, parts );
+	}
+
+	fn( arg, 0, parts );
+
+	for ( part = 1; part < parts; part++ )
+	{
+		if ( !started[part] )
+			continue;
+#ifdef _WIN32
+		WaitForSingleObject( threads[part], INFINITE );
+		CloseHandle( threads[part] );
+#else
+		pthread_join( threads[part], NULL );
+#endif
+	}
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* The order sym_sort_serial() puts keys in, as a comparison. */
+
+static int sym_key_compare( const SYM_SORT_KEY *a, const SYM_SORT_KEY *b,
+			    SYM_NAME_FN name_fn, const void *table )
+{
+	if ( a->prefix != b->prefix )
+		return ( a->prefix < b->prefix ) ? -1 : 1;
+	if ( a->value != b->value )
+		return ( a->value < b->value ) ? -1 : 1;
+	if ( name_fn && ( a->prefix & 0xff ) )
+		return sym_name_tail_compare( a, b, name_fn, table );
+	return ( a->index < b->index ) ? -1 : ( a->index > b->index );
+}
+
+typedef struct
+{
+	SYM_SORT_KEY		*keys;
+	uint32_t		count;
+	int			fields;
+	SYM_NAME_FN		name_fn;
+	const void		*table;
+	int			failed;
+
+/* The merge being done */
+
+	const SYM_SORT_KEY	*a, *b;
+	uint32_t		count_a, count_b;
+	SYM_SORT_KEY		*out;
+} SYM_SORT_JOB;
+
+/* Sort one slice of the keys. */
+
+static void sym_sort_slice( void *arg, int part, int parts )
+{
+SYM_SORT_JOB *job = arg;
+uint32_t start = (uint32_t)( (uint64_t)job->count * part / parts );
+uint32_t end = (uint32_t)( (uint64_t)job->count * ( part + 1 ) / parts );
+
+	if ( sym_sort_serial( job->keys + start, end - start, job->fields, job->name_fn, job->table ) < 0 )
+		job->failed = 1;
+}
+
+/* Work out how many of the first <n> merged keys come from a[]. */
+
+static uint32_t sym_merge_split( const SYM_SORT_JOB *job, uint32_t n )
+{
+uint32_t lo, hi, mid;
+
+	lo = ( n > job->count_b ) ? n - job->count_b : 0;
+	hi = ( n < job->count_a ) ? n : job->count_a;
+
+	while ( lo < hi )
+	{
+		mid = lo + ( hi - lo ) / 2;
+		if ( sym_key_compare( &job->a[mid], &job->b[n - mid - 1], job->name_fn, job->table ) < 0 )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Do one part of merging a[] and b[] into out[]. */
+
+static void sym_merge_part( void *arg, int part, int parts )
+{
+SYM_SORT_JOB *job = arg;
+uint32_t total = job->count_a + job->count_b;
+uint32_t start = (uint32_t)( (uint64_t)total * part / parts );
+uint32_t end = (uint32_t)( (uint64_t)total * ( part + 1 ) / parts );
+uint32_t i, j, k;
+
+	i = sym_merge_split( job, start );
+	j = start - i;
+
+	for ( k = start; k < end; k++ )
+	{
+		if ( j >= job->count_b ||
+		     ( i < job->count_a &&
+		       sym_key_compare( &job->a[i], &job->b[j], job->name_fn, job->table ) < 0 ) )
+			job->out[k] = job->a[i++];
+		else
+			job->out[k] = job->b[j++];
+	}
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Sort <count> keys by prefix, then value, then index.  <fields> says */
+/* which of SYM_SORT_PREFIX and SYM_SORT_VALUE have been filled in; the */
+/* other is taken to be 0 in every key and isn't looked at.  If <name_fn> */
+/* is given, keys with the same prefix and value whose names are longer */
+/* than the prefix are put in order by the rest of their names before */
+/* the index.  Returns 0 on success, or -1 if there wasn't enough memory. */
+
+int sym_sort_keys( SYM_SORT_KEY *keys, uint32_t count, int fields,
+		   SYM_NAME_FN name_fn, const void *table )
+{
+SYM_SORT_JOB job;
+SYM_SORT_KEY *temp, *from, *to, *swap;
+uint32_t bounds[SYM_SORT_MAX_THREADS + 1];
+int parts, runs, run;
+
+	parts = sort_threads;
+	if ( parts < 2 || count < SYM_SORT_PARALLEL_MIN )
+		return sym_sort_serial( keys, count, fields, name_fn, table );
+
+	temp = malloc( count * sizeof(SYM_SORT_KEY) );
+	if ( !temp )
+		return -1;
+
+	job.keys = keys;
+	job.count = count;
+	job.fields = fields;
+	job.name_fn = ( fields & SYM_SORT_PREFIX ) ? name_fn : NULL;
+	job.table = table;
+	job.failed = 0;
+
+	sym_run_parallel( sym_sort_slice, &job, parts );
+	if ( job.failed )
+	{
+		free( temp );
+		return -1;
+	}
+
+/* Merge the sorted slices in pairs until there's only one left. */
+
+	for ( run = 0; run <= parts; run++ )
+		bounds[run] = (uint32_t)( (uint64_t)count * run / parts );
+
+	from = keys;
+	to = temp;
+	for ( runs = parts; runs > 1; runs = ( runs + 1 ) / 2 )
+	{
+		for ( run = 0; run + 1 < runs; run += 2 )
+		{
+			job.a = from + bounds[run];
+			job.count_a = bounds[run + 1] - bounds[run];
+			job.b = from + bounds[run + 1];
+			job.count_b = bounds[run + 2] - bounds[run + 1];
+			job.out = to + bounds[run];
+			sym_run_parallel( sym_merge_part, &job, parts );
+			bounds[run / 2] = bounds[run];
+		}
+
+		if ( run < runs )
+		{
+			memcpy( to + bounds[run], from + bounds[run],
+				( bounds[run + 1] - bounds[run] ) * sizeof(SYM_SORT_KEY) );
+			bounds[run / 2] = bounds[run];
+		}
+		bounds[( runs + 1 ) / 2] = count;
+
+		swap = from;
+		from = to;
+		to = swap;
+	}
+
+	if ( from != keys )
+		memcpy( keys, from, count * sizeof(SYM_SORT_KEY) );
+
+	free( temp );
+	return 0;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Set dup[i] for each symbol that's the same as the one after it, */
+/* splitting the table between threads if it's big enough. */
+
+typedef struct
+{
+	const uint8_t HUGE	*records;
+	size_t			width;
+	uint32_t		count;
+	const SYM_TABLE		*table;
+	uint8_t			*dup;
+	uint8_t HUGE		*out;
+	uint32_t		kept[SYM_SORT_MAX_THREADS];
+} SYM_DUP_JOB;
+
+/* DRI symbols are the same if their names and values are, as when */
+/* sorting by name, with the 8 byte name and the value each compared in */
+/* one go.  COFF symbols are the same if their names are, and symbols */
+/* that share a string don't need to have it compared. */
+
+static void sym_mark_table_part( void *arg, int part, int parts )
+{
+SYM_DUP_JOB *job = arg;
+const SYM_TABLE *table = job->table;
+uint32_t i = (uint32_t)( (uint64_t)job->count * part / parts );
+uint32_t end = (uint32_t)( (uint64_t)job->count * ( part + 1 ) / parts );
+uint64_t name_a, name_b;
+
+	for ( ; i < end; i++ )
+	{
+		if ( i + 1 >= job->count )
+			job->dup[i] = 0;
+		else if ( table->dri_names )
+		{
+			memcpy( &name_a, table->pool + table->names[i], 8 );
+			memcpy( &name_b, table->pool + table->names[i + 1], 8 );
+			job->dup[i] = ( name_a == name_b && table->values[i] == table->values[i + 1] );
+		}
+		else
+		{
+			job->dup[i] = ( table->names[i] == table->names[i + 1] ||
+					!strcmp( table->pool + table->names[i],
+						 table->pool + table->names[i + 1] ) );
+		}
+	}
+}
+
+void sym_mark_table_duplicates( const SYM_TABLE *table, uint8_t *dup )
+{
+SYM_DUP_JOB job;
+
+	job.table = table;
+	job.count = table->count;
+	job.dup = dup;
+
+	if ( sort_threads < 2 || table->count < SYM_SORT_PARALLEL_MIN )
+		sym_mark_table_part( &job, 0, 1 );
+	else
+		sym_run_parallel( sym_mark_table_part, &job, sort_threads );
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Squeeze out the records marked in dup[], keeping the rest in order. */
+/* Returns how many records are left. */
+
+static void sym_count_part( void *arg, int part, int parts )
+{
+SYM_DUP_JOB *job = arg;
+uint32_t i = (uint32_t)( (uint64_t)job->count * part / parts );
+uint32_t end = (uint32_t)( (uint64_t)job->count * ( part + 1 ) / parts );
+uint32_t kept = 0;
+
+	for ( ; i < end; i++ )
+		kept += !job->dup[i];
+	job->kept[part] = kept;
+}
+
+static void sym_copy_part( void *arg, int part, int parts )
+{
+SYM_DUP_JOB *job = arg;
+uint32_t i = (uint32_t)( (uint64_t)job->count * part / parts );
+uint32_t end = (uint32_t)( (uint64_t)job->count * ( part + 1 ) / parts );
+uint8_t HUGE *out = job->out + job->kept[part] * job->width;
+
+	for ( ; i < end; i++ )
+	{
+		if ( !job->dup[i] )
+		{
+			memcpy( out, job->records + i * job->width, job->width );
+			out += job->width;
+		}
+	}
+}
+
+uint32_t sym_compact( void HUGE *records, size_t width, uint32_t count, const uint8_t *dup )
+{
+SYM_DUP_JOB job;
+uint8_t HUGE *ptr = records;
+uint32_t i, kept;
+int part, parts = sort_threads;
+
+	job.records = records;
+	job.width = width;
+	job.count = count;
+	job.dup = (uint8_t *)dup;
+	job.out = NULL;
+
+	if ( parts >= 2 && count >= SYM_SORT_PARALLEL_MIN )
+		job.out = malloc( count * width );
+
+/* In place with one thread, as the records only ever move down. */
+
+	if ( !job.out )
+	{
+		for ( i = kept = 0; i < count; i++ )
+		{
+			if ( dup[i] )
+				continue;
+			if ( kept != i )
+				memcpy( ptr + kept * width, ptr + i * width, width );
+			kept++;
+		}
+		return kept;
+	}
+
+/* Otherwise each thread counts what it keeps of its share, and then */
+/* copies it out to where the earlier shares leave off. */
+
+	sym_run_parallel( sym_count_part, &job, parts );
+	for ( part = 0, kept = 0; part < parts; part++ )
+	{
+		i = job.kept[part];
+		job.kept[part] = kept;
+		kept += i;
+	}
+	sym_run_parallel( sym_copy_part, &job, parts );
+
+	memcpy( records, job.out, kept * width );
+	free( job.out );
+	return kept;
+}
+
+/* Squeeze the symbols marked in dup[] out of every column of <table>. */
+/* The names stay where they are in the pool.  Returns how many are left. */
+
+uint32_t sym_compact_table( SYM_TABLE *table, const uint8_t *dup )
+{
+	sym_compact( table->values, sizeof(uint32_t), table->count, dup );
+	sym_compact( table->types, sizeof(uint16_t), table->count, dup );
+	sym_compact( table->descs, sizeof(uint16_t), table->count, dup );
+	table->count = sym_compact( table->names, sizeof(uint32_t), table->count, dup );
+	return table->count;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Rearrange <count> records of <width> bytes into the order of <keys>, */
+/* using the <count> * <width> bytes at <temp> to do it. */
+
+void sym_sort_apply( void *records, size_t width, const SYM_SORT_KEY *keys, uint32_t count,
+		     void *temp )
+{
+uint8_t *to;
+const uint8_t *from = records;
+uint32_t i;
+
+	if ( count < 2 )
+		return;
+
+	for ( i = 0, to = temp; i < count; i++, to += width )
+		memcpy( to, from + keys[i].index * width, width );
+
+	memcpy( records, temp, count * width );
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Sort a SYM_TABLE in place, by value alone if <by_name> is 0; */
+/* otherwise DRI names by all 8 bytes and then value, the same as */
+/* qsort() with the tools' old dri_symbol_compare() would, and COFF */
+/* names by the whole name alone.  DRI names were compared a char at a */
+/* time, so where char is signed, the top bit of each byte is flipped */
+/* to sort the same way as unsigned integers.  Symbols that compare */
+/* equal stay in file order.  Only the keys and then each */
+/* column in turn are moved, through one scratch buffer that's */
+/* allocated before any of them, so nothing can fail once the first */
+/* has been moved.  Returns 0 on success, or -1 if there wasn't enough */
+/* memory, in which case the table is left alone. */
+
+int sym_sort_table( SYM_TABLE *table, int by_name )
+{
+SYM_SORT_KEY *keys;
+uint32_t *temp;
+uint64_t flip = ( (char)-1 < 0 ) ? 0x8080808080808080ULL : 0;
+uint32_t i, count = table->count;
+const char *name;
+size_t len;
+int fields, result;
+
+	keys = malloc( ( count ? count : 1 ) * sizeof(SYM_SORT_KEY) );
+	temp = malloc( ( count ? count : 1 ) * sizeof(uint32_t) );	/* the widest column */
+	if ( !keys || !temp )
+	{
+		free( keys );
+		free( temp );
+		return -1;
+	}
+
+	for ( i = 0; i < count; i++ )
+	{
+		keys[i].prefix = 0;
+		keys[i].value = table->values[i];
+		keys[i].index = i;
+
+		if ( by_name && table->dri_names )
+			keys[i].prefix = sym_name_prefix( table->pool + table->names[i], 8 ) ^ flip;
+		else if ( by_name )
+		{
+			name = sym_table_name( table, i, &len );
+			keys[i].prefix = sym_name_prefix( name, len );
+			keys[i].value = 0;
+		}
+	}
+
+	if ( !by_name )
+		fields = SYM_SORT_VALUE;
+	else if ( table->dri_names )
+		fields = SYM_SORT_PREFIX | SYM_SORT_VALUE;
+	else
+		fields = SYM_SORT_PREFIX;
+
+	result = sym_sort_keys( keys, count, fields,
+				table->dri_names ? NULL : sym_table_name, table );
+	if ( result == 0 )
+	{
+		sym_sort_apply( table->values, sizeof(uint32_t), keys, count, temp );
+		sym_sort_apply( table->types, sizeof(uint16_t), keys, count, temp );
+		sym_sort_apply( table->descs, sizeof(uint16_t), keys, count, temp );
+		sym_sort_apply( table->names, sizeof(uint32_t), keys, count, temp );
+	}
+
+	free( keys );
+	free( temp );
+	return result;
+}
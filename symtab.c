@@ -0,0 +1,209 @@
+/*
+	symtab.c
+
+	Column by column symbol table.  The symbols of either format are
+	decoded once, straight out of the file image, into separate arrays
+	of values, types, descriptions and name offsets plus a pool of
+	names, so that a pass which only filters on the types or scans the
+	values streams through just those arrays instead of whole symbol
+	records, and nothing downstream has to byte swap anything again.
+	Sorting and dropping duplicates move the columns (see symsort.c),
+	never the names themselves.
+*/
+
+#include "size.h"
+#include "proto.h"
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Allocate the columns for <count> symbols, and a <pool_size> byte pool */
+/* for their names. */
+
+static int sym_table_alloc( SYM_TABLE *table, uint32_t count, uint32_t pool_size )
+{
+size_t n = count ? count : 1;
+
+	memset( table, 0, sizeof(*table) );
+	table->values = malloc( n * sizeof(uint32_t) );
+	table->types = malloc( n * sizeof(uint16_t) );
+	table->descs = malloc( n * sizeof(uint16_t) );
+	table->names = malloc( n * sizeof(uint32_t) );
+	table->pool = malloc( pool_size ? pool_size : 1 );
+
+	if ( !table->values || !table->types || !table->descs || !table->names || !table->pool )
+	{
+		sym_table_free( table );
+		return SYM_TABLE_NO_MEMORY;
+	}
+
+	table->count = count;
+	table->pool_size = pool_size;
+	return SYM_TABLE_OK;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Read <count> DRI symbols from the current position.  Like the rest of */
+/* the tools, a table cut short by the end of the file is padded out */
+/* with zeros rather than treated as an error. */
+
+int sym_table_read_dri( SYM_TABLE *table, IN_FILE *in, uint32_t count )
+{
+const uint8_t *data;
+uint8_t *copy = NULL;
+uint32_t sym;
+char *name;
+
+	if ( count > 0x10000000UL )
+		return SYM_TABLE_NO_MEMORY;
+
+	if ( ( data = in_get( in, count * 14 ) ) == NULL )
+	{
+		if ( ( copy = malloc( count * 14 + 1 ) ) == NULL )
+			return SYM_TABLE_NO_MEMORY;
+		in_read( in, count * 14, copy );
+		data = copy;
+	}
+
+	if ( sym_table_alloc( table, count, count * 9 ) < 0 )
+	{
+		free( copy );
+		return SYM_TABLE_NO_MEMORY;
+	}
+
+	get_dri_columns( data, count, table->types, table->values );
+
+/* Each name gets its 8 bytes and a NUL, whether it fills them or not. */
+
+	name = table->pool;
+	for ( sym = 0; sym < count; sym++ )
+	{
+		memcpy( name, data, 8 );
+		name[8] = 0;
+		table->names[sym] = sym * 9;
+		table->descs[sym] = 0;
+
+		name += 9;
+		data += 14;
+	}
+
+	table->dri_names = 1;
+	free( copy );
+	return SYM_TABLE_OK;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Read <count> BSD/COFF symbols from the current position, and the */
+/* string table that follows them.  The string table starts with its */
+/* own 4-byte size, so the symbols' name offsets are adjusted by -4. */
+/* Names that are out of range point at a NUL at the end of it. */
+
+int sym_table_read_coff( SYM_TABLE *table, IN_FILE *in, uint32_t count )
+{
+const uint8_t *data, *strings;
+uint32_t sym, offset, strings_size, end;
+size_t avail;
+char *pool;
+
+	if ( count > 0x10000000UL )
+		return SYM_TABLE_NO_MEMORY;
+
+	if ( ( data = in_get( in, count * 12 ) ) == NULL )
+		return SYM_TABLE_SHORT;
+
+	if ( sym_table_alloc( table, count, 0 ) < 0 )
+		return SYM_TABLE_NO_MEMORY;
+
+/* The names can't be checked against the string table until its size */
+/* has been read, so hold on to the raw offsets until then. */
+
+	get_bsd_columns( data, count, table->names, table->types, table->descs, table->values );
+
+	strings_size = readlong( in );
+
+/* The string table can run to megabytes of source paths and type */
+/* strings that a lookup never looks at, so if the file is mapped and */
+/* the table ends with a NUL of its own, use it where it is.  Then only */
+/* the pages holding names that are actually looked at get read in. */
+/* Whatever part of the table is past the end of the file reads as */
+/* zeros when copied, so leaving that part off makes no difference. */
+
+	strings = in_map( in, &avail );
+	if ( strings && avail > strings_size )
+		avail = strings_size;
+
+	if ( strings && avail > 0 && strings[avail - 1] == 0 )
+	{
+		free( table->pool );
+		table->pool = (char *)strings;
+		table->pool_size = (uint32_t)avail;
+		table->pool_mapped = 1;
+		end = (uint32_t)avail - 1;
+	}
+	else
+	{
+		if ( strings_size > 0xfffffffeUL ||
+		     ( pool = realloc( table->pool, (size_t)strings_size + 1 ) ) == NULL )
+		{
+			sym_table_free( table );
+			return SYM_TABLE_NO_MEMORY;
+		}
+
+		in_read( in, strings_size, pool );
+		pool[strings_size] = 0;
+		table->pool = pool;
+		table->pool_size = strings_size + 1;
+		end = strings_size;
+	}
+
+	for ( sym = 0; sym < count; sym++ )
+	{
+		offset = table->names[sym];
+		if ( offset >= end )
+			table->names[sym] = end;
+	}
+
+	return SYM_TABLE_OK;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+void sym_table_free( SYM_TABLE *table )
+{
+	free( table->values );
+	free( table->types );
+	free( table->descs );
+	free( table->names );
+	if ( !table->pool_mapped )
+		free( table->pool );
+	memset( table, 0, sizeof(*table) );
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Name and value lookup functions, for sym_hash_build() and friends. */
+
+const char *sym_table_name( const void *table, uint32_t sym, size_t *len )
+{
+const SYM_TABLE *symtab = table;
+const char *name = symtab->pool + symtab->names[sym];
+
+	*len = strlen( name );
+	return name;
+}
+
+uint32_t sym_table_value( const void *table, uint32_t sym )
+{
+	return ((const SYM_TABLE *)table)->values[sym];
+}
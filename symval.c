@@ -14,6 +14,10 @@
 /**************************************************************************/
 /**************************************************************************/
 
+#ifdef __linux__
+#define _GNU_SOURCE		/* for memmem() */
+#endif
+
 #include "size.h"
 #include "proto.h"
 
@@ -28,469 +32,550 @@
 #define MAJOR_VERSION (1)
 #define MINOR_VERSION (2)
 
+#define SCAN_MAX_NAMES	(4)	/* Most names looked up without an index */
+
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-ABS_HDR theHeader, tmpHeader;
-COF_HDR coff_header;
-RUN_HDR run_header;
-SEC_HDR txt_header, dta_header, bss_header;
-BSD_Object bsd_object;
-BSD_Symbol *coff_symbols;
-
 int show_symbols = 0;
 int skip_duplicates = 1;
 
-char *coff_symbol_name_strings;
-
-char **symbol_name_list;		/* list of symbols whose values we want printed, 1 per line */
+char **symbol_name_list;		/* symbols whose values we want printed, NULL terminated */
+static char **next_name;		/* the next of them to look up in the current file */
 
 char *fmt_string = "%04lx";		/* format string for output */
 
+short use_cache = 0;			/* -c */
+int file_count = 0;			/* files to look the symbols up in */
+
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
-/* Returns -1 if a<b, 0 if a=b, or 1 if a>b */
 
-int dri_symbol_name_compare( const void *a, const char *b )
+/* Add <name> to the end of symbol_name_list, which has room for */
+/* <*max_count> names and the NULL after them.  <name> is NULL if there */
+/* wasn't the memory to copy it. */
+
+static void add_symbol_name( char *name, size_t *count, size_t *max_count )
 {
-char HUGE *aa;
-int i;
-	aa = (char HUGE *)a;
-	{
-		for( i = 0; i < 8; i++ )	/* Check byte by byte so it fails faster! */
-		{
-			if( *aa > *b )
-			  return(1);
-			else if( *aa < *b )
-			  return(-1);
+char **grown = symbol_name_list;
 
-			aa++;
-			b++;
-		}
+	if (name && *count + 1 >= *max_count)
+	{
+		*max_count = *max_count ? *max_count * 2 : 64;
+		grown = realloc(symbol_name_list, *max_count * sizeof(char *));
+	}
+	if (!name || !grown)
+	{
+		fprintf(stderr, "Cannot allocate memory for symbol names!\n");
+		exit(-1);
 	}
-	return 0;
-}
 
-/**************************************************************************/
-/**************************************************************************/
-/**************************************************************************/
+	symbol_name_list = grown;
+	symbol_name_list[(*count)++] = name;
+	symbol_name_list[*count] = NULL;
+}
 
-/* Returns -1 if a<b, 0 if a=b, or 1 if a>b */
+/* Gather up the symbol names to look up from <args>, the rest of the */
+/* command line, into symbol_name_list.  They're taken in order, except */
+/* that "-" reads names from stdin and "-@ listfile" reads them from */
+/* listfile, one per line.  That's all done once, before any file is */
+/* looked at, as the same names are looked up in each of them. */
 
-int coff_symbol_name_compare( const void *a, const char *b )
+static void read_symbol_names( char **args )
 {
-BSD_Symbol HUGE *sym1;
-char HUGE *str1;
-long offset;
-int i;
-
-	sym1 = (BSD_Symbol *)a;
+char line[1024];
+static char *no_names[] = { NULL };
+char *start, *end;
+size_t count = 0, max_count = 0;
+FILE *file;
 
-	i = 0;
+	for ( ; *args; args++)
 	{
-		offset = sym1->name_offset;
-		str1 = &coff_symbol_name_strings[offset] - 4;
-	
-		i = strcmp(str1, b);
-	}
-	return(i);
-}
-
-/**************************************************************************/
-/**************************************************************************/
-/**************************************************************************/
+		if (!strcmp(*args, "-"))
+			file = stdin;
+		else if (!strcmp(*args, "-@"))
+		{
+			file = fopen(*++args, "r");
+			if (!file)
+			{
+				fprintf(stderr, "Can't open symbol list file %s\n", *args);
+				exit(1);
+			}
+		}
+		else
+		{
+			add_symbol_name(*args, &count, &max_count);
+			continue;
+		}
 
-/* Read in a BSD/COFF SEC_HDR structure from the file. */
-/* For Jaguar we don't really care about all of the fields, */
-/* but we still have to read them all! */
+		while (fgets(line, sizeof(line), file))
+		{
+			/* trim surrounding whitespace, skip blank lines */
+			for (start = line; *start == ' ' || *start == '\t'; start++)
+				;
+			end = start + strlen(start);
+			while (end > start && (end[-1] == '\n' || end[-1] == '\r' ||
+					       end[-1] == ' ' || end[-1] == '\t'))
+				end--;
+			*end = 0;
+
+			if (*start)
+				add_symbol_name(strdup(start), &count, &max_count);
+		}
 
-void read_sec_hdr( int in_handle, SEC_HDR *section )
-{
-	Fread(in_handle, 8L, &section->name);
+		if (file != stdin)
+			fclose(file);
+	}
 
-	section->start_address = readlong(in_handle);
-	section->start_address_2 = readlong(in_handle);
+	if (!count)
+		symbol_name_list = no_names;
+}
 
-	section->size = readlong(in_handle);
+/* Return the next symbol name to look up in the current file, or NULL */
+/* when there are no more. */
 
-	section->offset = readlong(in_handle);
-	section->relocation_data = readlong(in_handle);
-	section->debug_info = readlong(in_handle);
-	section->num_reloc_entries = readshort(in_handle);
-	section->num_debug_entries = readshort(in_handle);
-	section->flags = readlong(in_handle);
+char *next_symbol_name( void )
+{
+	return *next_name ? *next_name++ : NULL;
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-/* Read the header, determine if the file is BSD/COFF or DRI format, then */
-/* do the appropriate steps to write out the TEXT, DATA, and maybe the */
-/* SYMBOLS file */
+/* Print a symbol's value in the -f format.  The usual hex formats, */
+/* %lx and %0<n>lx, are converted directly and anything else is left */
+/* to snprintf(). */
+
+static int value_digits = 0;		/* digits of a plain hex format, or 0 */
 
-short process_abs_file( char *fname, int in_handle )
+static void find_value_digits( const char *fmt )
 {
-char *ptr, original_fname[256];
+int digits = 1;
 
-/* Save a copy of the original filename, then strip off the filename extension. */
+	if( *fmt++ != '%' )
+		return;
 
-	strncpy( original_fname, fname, 256 );
-	if((ptr = strchr(fname,'.')) != NULL)
-	  *ptr=0;
+	if( *fmt == '0' )
+	{
+		for( digits = 0, fmt++; *fmt >= '0' && *fmt <= '9'; fmt++ )
+			digits = digits * 10 + *fmt - '0';
+	}
 
-	theHeader.magic = readshort( in_handle );
-	
-/* BSD Objects have a LONG magic number, so move to start, read it, */
-/* then move back to where we started. (At 2 bytes into file). */
+	if( !strcmp( fmt, "lx" ) && digits >= 1 && digits <= 8 )
+		value_digits = digits;
+}
 
-	Fseek( 0L, in_handle, 0 );
-	bsd_object.magic = readlong(in_handle);
-	Fseek( 2L, in_handle, 0 );
+static void print_value( long value )
+{
+char buf[256];
+int len;
 
-/* See if the magic number indicates a DRI/Alcyon-format executable or object module file */
-	
-	if( theHeader.magic == 0x601b || theHeader.magic == 0x601a )
-	{			
-		read_dri_header( in_handle );
-		  print_dri_symbols( in_handle );
-		return(1);
+	if( value_digits )
+	{
+		out_hex( (uint32_t)value, value_digits );
 	}
-
-/* Not DRI-format, so test for BSD/COFF. */
-	
-	else if( theHeader.magic == 0x0150 ||
-		(theHeader.magic == 0x0000 && bsd_object.magic == 0x00000107L) )
+	else if( ( len = snprintf( buf, sizeof(buf), fmt_string, value ) ) >= (int)sizeof(buf) )
 	{
-		read_coff_header( in_handle );
-		  print_coff_symbols( in_handle );
-		return(1);
+		out_flush();
+		printf( fmt_string, value );
 	}
-
-/* Sorry, don't know what it is. */
-
-	else
+	else if( len > 0 )
 	{
-		fprintf(stderr, "Error: Wrong file type.  Magic number = 0x%04x\n", theHeader.magic );
-		Fclose(in_handle);
-		exit(1);
+		out_bytes( buf, len );
 	}
-	return(0);
+	out_eol();
+}
+
+static void print_not_found( const char *name )
+{
+	out_str( name );
+	out_str( ": symbol not found" );
+	out_eol();
+}
+
+/* The symbol index kept alongside the file open in <obj>. */
+
+static void cache_name( char *buf, const OBJ_FILE *obj )
+{
+	sprintf( buf, "%s.symidx", obj->name );
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-void read_dri_header( int in_handle )
-{
-	theHeader.tsize = readlong(in_handle);
-	theHeader.dsize = readlong(in_handle);
-	theHeader.bsize = readlong(in_handle);
-	theHeader.ssize = readlong(in_handle);
+/* Look up the symbols in the file open in <obj>.  Returns 0, or -1 if */
+/* something went wrong (which has been reported). */
 
-	if( theHeader.magic == 0x601b )		/* If it's an executable... */
-	{
-		theHeader.res1 = readlong(in_handle);		/* not used... */
-		theHeader.tbase = readlong(in_handle);
-		theHeader.relocflag = readshort(in_handle);	/* not used... */
-		theHeader.dbase = readlong(in_handle);
-		theHeader.bbase = readlong(in_handle);
-	}
+short process_abs_file( OBJ_FILE *obj )
+{
+	if( obj->kind == OBJ_DRI_ABS || obj->kind == OBJ_DRI_OBJECT )
+	  return print_dri_symbols( obj );
+	return print_coff_symbols( obj );
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-void read_coff_header( int in_handle )
+/* The symbols in a .sym file from filefix are sorted by name, so each */
+/* name can be found with a binary search straight out of the mapped */
+/* file, which only reads in the pages the search lands on.  Returns 0 */
+/* if it was done, or 1 if the file isn't mapped (before anything is */
+/* looked up). */
+
+static int search_sorted_symbols( OBJ_FILE *obj )
 {
-	if( theHeader.magic == 0x0150 )
+const uint8_t *syms, *sym;
+uint32_t count, lo, hi, mid;
+size_t avail, len;
+char *cursymbol, key[8];
+
+	count = obj_symbol_count( obj );
+	in_seek( &obj->in, obj_symbol_offset( obj ) );
+	syms = in_map( &obj->in, &avail );
+	if( ! syms || avail / 14 < count )
+	  return 1;
+
+	for (cursymbol = next_symbol_name(); cursymbol; cursymbol = next_symbol_name())
 	{
-		Fseek( 0L, in_handle, 0 );
-
-		coff_header.magic = readshort(in_handle);
-		coff_header.num_sections = readshort(in_handle);
-		coff_header.date = readlong(in_handle);
-		coff_header.sym_offset = readlong(in_handle);
-		coff_header.num_symbols = readlong(in_handle);
-		coff_header.opt_hdr_size = readshort(in_handle);
-		coff_header.flags = readshort(in_handle);
-
-		run_header.magic = readlong(in_handle);
-		run_header.tsize = readlong(in_handle);
-		run_header.dsize = readlong(in_handle);
-		run_header.bsize = readlong(in_handle);
-		run_header.entry = readlong(in_handle);
-		run_header.tbase = readlong(in_handle);
-		run_header.dbase = readlong(in_handle);
-	}
-	else
-	{		
-		Fseek( 0L, in_handle, 0 );
-
-		bsd_object.magic = readlong(in_handle);
-		bsd_object.tsize = readlong(in_handle);
-		bsd_object.dsize = readlong(in_handle);
-		bsd_object.bsize = readlong(in_handle);
-		bsd_object.ssize = readlong(in_handle);
-		bsd_object.entry = readlong(in_handle);
-		bsd_object.trsize = readlong(in_handle);
-		bsd_object.drsize = readlong(in_handle);
-
-		coff_header.num_sections = 3;
-
-		coff_header.sym_offset = PACKED_SIZEOF(BSD_Object);
-		coff_header.sym_offset += bsd_object.tsize;
-		coff_header.sym_offset += bsd_object.dsize;
-		coff_header.sym_offset += bsd_object.trsize;
-		coff_header.sym_offset += bsd_object.drsize;
-		
-		coff_header.num_symbols = bsd_object.ssize / PACKED_SIZEOF(BSD_Symbol);
-		coff_header.opt_hdr_size = 0L;
-		coff_header.flags = 0L;
-	}
-	
-	read_sec_hdr(in_handle, &txt_header);
-	read_sec_hdr(in_handle, &dta_header);
-	read_sec_hdr(in_handle, &bss_header);
+		len = strlen(cursymbol);
+		if (len > 8)
+			len = 8;
+		memset( key, 0, sizeof(key) );
+		memcpy( key, cursymbol, len );
 
-/* OK, now we've gotta set up the DRI-format ABS header so */
-/* that we can use it to write the RDBJAG script file later. */
-
-	theHeader.tsize = txt_header.size;
-	theHeader.tbase = txt_header.start_address;
-
-	theHeader.dsize = dta_header.size;
-	theHeader.dbase = dta_header.start_address;
+		for( lo = 0, hi = count; lo < hi; )
+		{
+			mid = lo + ( hi - lo ) / 2;
+			if( memcmp( syms + (size_t)mid * 14, key, 8 ) < 0 )
+			  lo = mid + 1;
+			else
+			  hi = mid;
+		}
 
-	theHeader.bsize = bss_header.size;
-	theHeader.bbase = bss_header.start_address;
+		sym = syms + (size_t)lo * 14;
+		if( lo == count || memcmp( sym, key, 8 ) )
+		{
+			print_not_found(cursymbol);
+			continue;
+		}
 
-	theHeader.ssize = 0;		/* We don't do anything with symbols yet... */
-	theHeader.res1 = 0;		/* not used... */
-	theHeader.relocflag = 0;	/* not used... */
+		/* print every symbol with this name, in file order */
+		for( ; lo < count && ! memcmp( sym, key, 8 ); lo++, sym += 14 )
+		  print_value( (long)getlong( sym + 10 ) );
+	}
+	return 0;
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-void print_dri_info(void)
+int print_dri_symbols( OBJ_FILE *obj )
 {
-#if 0
-	printf( "Text segment size = 0x%08lx bytes\n", theHeader.tsize );
-	printf( "Data segment size = 0x%08lx bytes\n", theHeader.dsize );
-	printf( "BSS Segment size = 0x%08lx bytes\n", theHeader.bsize );
+IN_FILE *in = &obj->in;
+uint32_t sym;
+size_t len;
+SYM_TABLE table;
+char *cursymbol, cachename[264];
+SYM_HASH hash;
+int err;
+
+	if( ! use_cache && obj_dri_sorted( obj ) && ( err = search_sorted_symbols( obj ) ) <= 0 )
+	  return(err);
 
-	printf( "Symbol Table size = 0x%08lx bytes\n", theHeader.ssize );
+/* Read the symbols, print the ones asked for. */
+/* This sort of assumes your symbol table will fit in available */
+/* memory (MSDOS memory... less than 600K), but this shouldn't be */
+/* a big problem. */
 
-	if( theHeader.magic != 0x601a )		/* If not an OBJECT module */
+	if( obj_read_symbols( obj, &table ) < 0 )
 	{
-		printf( "Absolute Address for text segment = 0x%08lx\n", theHeader.tbase );
-		printf( "Absolute Address for data segment = 0x%08lx\n", theHeader.dbase );
-		printf( "Absolute Address for BSS segment = 0x%08lx\n\n", theHeader.bbase );
+		printf( "Cannot allocate sufficient memory (%" PRId32 " bytes) for buffer!\n", obj->header.ssize );
+		return(-1);
 	}
 
-#endif
-}
+/* Index the names once, then look up everything that was asked for. */
+/* Only the first 8 characters of each name are significant. */
 
-/**************************************************************************/
-/**************************************************************************/
-/**************************************************************************/
+	if( sym_hash_build( &hash, table.count, sym_table_name, &table ) < 0 )
+	{
+		fprintf( stderr, "Cannot allocate memory for symbol index!\n" );
+		sym_table_free( &table );
+		return(-1);
+	}
 
-void print_coff_info(void)
-{
-#if 0
-	if( theHeader.magic == 0x0150 )
+	for (cursymbol = next_symbol_name(); cursymbol; cursymbol = next_symbol_name())
 	{
-		printf( "Text Segment Size = 0x%08lx\n", run_header.tsize );
-		printf( "Data Segment Size = 0x%08lx\n", run_header.dsize );
-		printf( "BSS Segment Size = 0x%08lx\n", run_header.bsize );
+		len = strlen(cursymbol);
+		if (len > 8)
+			len = 8;
 
-		printf( "Symbol Table contains %ld symbol entries\n", coff_header.num_symbols );
+		sym = sym_hash_find(&hash, cursymbol, len);
+		if (sym == SYM_NONE)
+			print_not_found(cursymbol);
 
-		printf( "Starting Address for executable = 0x%08lx\n", run_header.entry );
-		printf( "Start of Text Segment = 0x%08lx\n", run_header.tbase );
-		printf( "Start of Data Segment = 0x%08lx\n", run_header.dbase );
-	
-		printf( "Start of BSS Segment = 0x%08lx\n\n", bss_header.start_address );
+		/* print every symbol with this name, in file order */
+		for ( ; sym != SYM_NONE; sym = sym_hash_next(&hash, sym))
+		{
+			print_value( (long)table.values[sym] );
+		}
 	}
-	else
+
+	sym_hash_free( &hash );
+
+	if( use_cache )
 	{
-		printf( "Text Segment Size = 0x%08lx\n", bsd_object.tsize );
-		printf( "Data Segment Size = 0x%08lx\n", bsd_object.dsize );
-		printf( "BSS Segment Size = 0x%08lx\n", bsd_object.bsize );
+		cache_name( cachename, obj );
+		sym_cache_write( cachename, in, obj_symbol_offset( obj ), table.count,
+				 sym_table_name, sym_table_value, &table, SYM_CACHE_DRI_NAMES );
 	}
-#endif
+
+	sym_table_free( &table );
+	return(0);
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-void print_dri_symbols( int fhand )
+/* With just a few names to look up, it's quicker to search the raw */
+/* string table for each of them and then pick out the symbols that */
+/* point at it than to decode the whole symbol table and index every */
+/* name. */
+
+static int few_names( void )
 {
-char HUGE *ptr;
-long longcount, skipped, offset;
-void HUGE *symbuf, HUGE *a, HUGE *b;
-char **cursymbol;
+char **name;
+int count = 0;
 
-/* Read the symbols, print the ones asked for. */
-/* This sort of assumes your symbol table will fit in available */
-/* memory (MSDOS memory... less than 600K), but this shouldn't be */
-/* a big problem. */
+	for( name = symbol_name_list; *name; name++ )
+	{
+		if( ! **name || ++count > SCAN_MAX_NAMES )
+		  return 0;
+	}
+	return 1;
+}
+
+/* memmem(), which the C library does far faster than a byte at a time, */
+/* where there is one. */
 
-	if( theHeader.magic == 0x601b )					/* ABS executable */
-	  offset = PACKED_SIZEOF(ABS_HDR) + theHeader.tsize + theHeader.dsize;
-	else								/* Object Module */
-	  offset = PACKED_SIZEOF(DRI_Object) + theHeader.tsize + theHeader.dsize;
+static const char *find_bytes( const char *hay, size_t hay_len, const char *needle, size_t len )
+{
+#if defined(_WIN32) || defined(__MSDOS__)
+const char *end = hay + hay_len;
 
-	Fseek( offset, fhand, 0 );
-	symbuf = farmalloc(theHeader.ssize);
-	if( ! symbuf)
+	while( (size_t)( end - hay ) >= len &&
+	       ( hay = memchr( hay, *needle, (size_t)( end - hay ) - len + 1 ) ) != NULL )
 	{
-		printf( "Cannot allocate sufficient memory (%" PRId32 " bytes) for buffer!\n", theHeader.ssize );
-		exit(-1);
+		if( ! memcmp( hay, needle, len ) )
+		  return hay;
+		hay++;
 	}
+	return NULL;
+#else
+	return memmem( hay, hay_len, needle, len );
+#endif
+}
 
-/* Read the symbols one at a time (because doing it in one chunk isn't working right...) */
+/* Find the symbol called <name> among the <count> raw 12-byte records */
+/* at <syms>, whose string table (less its size) is the <strings_size> */
+/* bytes at <strings>.  A symbol with that name has to point at one of */
+/* the places "<name>\0" turns up in the strings, so only the records' */
+/* name offsets need comparing with those, and nothing else in them is */
+/* decoded unless they match.  As with the index, the first one in the */
+/* file is the one found.  Returns 1 with the value in <*value> if */
+/* there's one, 0 if there isn't, or -1 if there wasn't enough memory. */
+
+static int scan_coff_symbol( const uint8_t *syms, uint32_t count, const char *strings,
+			     size_t strings_size, const char *name, uint32_t *value )
+{
+const char *hit, *end = strings + strings_size;
+const uint8_t *rec;
+size_t len = strlen( name ) + 1;	/* including its NUL */
+uint32_t *offsets = NULL, *grown, num_offsets = 0, max_offsets = 0;
+uint32_t sym, offset, lo, hi, mid;
 
-	ptr = (char *)symbuf;
-	for( longcount = 0; longcount < theHeader.ssize; longcount += 14 )
+	for( hit = strings; ( hit = find_bytes( hit, (size_t)( end - hit ), name, len ) ) != NULL; hit++ )
 	{
-		Fread( fhand, 14L, ptr );
-		ptr += 14;
+		if( num_offsets == max_offsets )
+		{
+			max_offsets = max_offsets ? max_offsets * 2 : 16;
+			grown = realloc( offsets, max_offsets * sizeof(uint32_t) );
+			if( ! grown )
+			{
+				free( offsets );
+				return -1;
+			}
+			offsets = grown;
+		}
+		offsets[num_offsets++] = (uint32_t)( hit - strings ) + 4;
 	}
 
-	ptr = symbuf;
+	if( ! num_offsets )
+	  return 0;
 
-	for (cursymbol = symbol_name_list; *cursymbol; cursymbol++)
-	{
+/* The offsets were found in order, so each record's can be looked */
+/* for with a binary search. */
 
-		skipped = 1;
-		for (longcount = 0 ; longcount < theHeader.ssize ; longcount += 14)
+	for( sym = 0, rec = syms; sym < count; sym++, rec += 12 )
+	{
+		offset = getlong( rec );
+		for( lo = 0, hi = num_offsets; lo < hi; )
 		{
-			short i;
-			long symval;
+			mid = ( lo + hi ) / 2;
+			if( offsets[mid] < offset )
+			  lo = mid + 1;
+			else
+			  hi = mid;
+		}
+		if( lo < num_offsets && offsets[lo] == offset )
+		  break;
+	}
 
-			a = ptr;
+	free( offsets );
 
-			/* if we should print this symbol, do so */
-			if (!dri_symbol_name_compare(a, *cursymbol))
-			{
+	if( sym == count )
+	  return 0;
 
-				for( i = 0; i < 8; i++ )
-				{
-					if( ptr[i] == 0 )
-					{
-						for( ; i < 8; i++ )
-						  ptr[i] = ' ';
-					}
-				}
+	*value = getlong( rec + 8 );
+	return 1;
+}
 
-/* print the values byte by byte because it works on any machine... */
-				symval = 
-					(((unsigned long)ptr[10] & 0xff) << 24) |
-					(((unsigned long)ptr[11] & 0xff) << 16) |
-					(((unsigned int)ptr[12] & 0xff) << 8) |  ((unsigned int)ptr[13] & 0xff );
+/* Look the names up that way, straight out of the mapped file.  Returns */
+/* 0 if it was done, 1 if the file isn't one it can be done on (before */
+/* anything is looked up), or -1 if something went wrong. */
 
-				printf( fmt_string, symval );
-				printf("\n");
-				skipped = 0;
-			}
-			ptr += 14;
+static int scan_coff_symbols( OBJ_FILE *obj )
+{
+const uint8_t *syms;
+const char *strings;
+char *cursymbol;
+uint32_t count, value;
+size_t avail, strings_size;
+int found;
+
+	count = obj_symbol_count( obj );
+	in_seek( &obj->in, obj_symbol_offset( obj ) );
+	syms = in_map( &obj->in, &avail );
+	if( ! syms || count > 0x10000000UL || avail < (size_t)count * 12 + 4 )
+	  return 1;
+
+/* The string table has to end with a NUL of its own, just as for */
+/* using it where it is in sym_table_read_coff(). */
+
+	strings_size = getlong( syms + (size_t)count * 12 );
+	strings = (const char *)syms + (size_t)count * 12 + 4;
+	avail -= (size_t)count * 12 + 4;
+	if( strings_size > avail )
+	  strings_size = avail;
+	if( ! strings_size || strings[strings_size - 1] )
+	  return 1;
+
+	for ( cursymbol = next_symbol_name(); cursymbol; cursymbol = next_symbol_name() )
+	{
+		found = scan_coff_symbol( syms, count, strings, strings_size, cursymbol, &value );
+		if( found < 0 )
+		{
+			fprintf( stderr, "Cannot allocate memory for symbol information!\n" );
+			return -1;
 		}
-
-		if (skipped)
-			printf("%s: symbol not found\n", *cursymbol);
+		if( found )
+		  print_value( (long)value );
+		else
+		  print_not_found( cursymbol );
 	}
-	farfree( symbuf );
+	return 0;
 }
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-void print_coff_symbols( int fhand )
+int print_coff_symbols( OBJ_FILE *obj )
 {
-long sym, symsize, stringtable_size, offset;
-long skipped, unknown_type;
-char **cursymbol;
-
-/* Calculate the size needed for the symbol table */
+IN_FILE *in = &obj->in;
+uint32_t match;
+char *cursymbol, cachename[264];
+int err;
+SYM_TABLE table;
+SYM_HASH hash;
 
-	symsize = coff_header.num_symbols * sizeof(BSD_Symbol);
+	if( ! use_cache && few_names() && ( err = scan_coff_symbols( obj ) ) <= 0 )
+	  return(err);
 
-/* Move to the symbol table, allocate memory for it */
+/* Move to the symbol table and read it, along with its string table */
 	
-	offset = coff_header.sym_offset;
-	Fseek(offset,fhand,0);
-
-	coff_symbols = (BSD_Symbol *)farmalloc( symsize );
-	if( ! coff_symbols )
+	if( ( err = obj_read_symbols( obj, &table ) ) < 0 )
 	{
-		fprintf( stderr, "Cannot allocate memory for symbol information!\n" );
-		exit(-1);
+		obj_perror( stderr, obj, err, obj->name );
+		return(-1);
 	}
 
-/* Read the symbols in one by one */
+/* Index the names once, then look up everything that was asked for. */
 
-	for( sym = 0; sym < coff_header.num_symbols; sym++ )
+	if( sym_hash_build( &hash, table.count, sym_table_name, &table ) < 0 )
 	{
-		coff_symbols[sym].name_offset = readlong( fhand );
-		coff_symbols[sym].type = readbyte( fhand );
-		coff_symbols[sym].other = readbyte( fhand );
-		coff_symbols[sym].description = readshort( fhand );
-		coff_symbols[sym].value = readlong( fhand );
+		fprintf( stderr, "Cannot allocate memory for symbol index!\n" );
+		sym_table_free( &table );
+		return(-1);
 	}
 
-/* Get the size of the string table (the name strings that go with */
-/* the symbols) then allocate some memory and read it in. */
-/* The string table starts with a longword containing the size, so the */
-/* offsets used by the symbols must be adjusted by -4 when you access */
-/* the individual strings. */
+	for ( cursymbol = next_symbol_name(); cursymbol; cursymbol = next_symbol_name() )
+	{
+		/* only the first symbol with a given name is printed */
+		match = sym_hash_find( &hash, cursymbol, strlen(cursymbol) );
+		if (match != SYM_NONE) {
+			print_value( (long)table.values[match] );
+		} else {
+			print_not_found(cursymbol);
+		}
+	}	
 
-	stringtable_size = readlong( fhand );
-	
-	coff_symbol_name_strings = farmalloc( stringtable_size );
-	if( ! coff_symbol_name_strings )
+	sym_hash_free( &hash );
+
+	if( use_cache )
 	{
-		fprintf( stderr, "Cannot allocate memory for symbol information!\n" );
-		exit(-1);
+		cache_name( cachename, obj );
+		sym_cache_write( cachename, in, obj_symbol_offset( obj ), table.count,
+				 sym_table_name, sym_table_value, &table, 0 );
 	}
 
-	Fread( fhand, stringtable_size, coff_symbol_name_strings );
+	sym_table_free( &table );
+	return(0);
+}
+
+/* Answer the lookups from an up to date symbol index, without reading */
+/* the symbol table at all. */
 
-	for ( cursymbol = symbol_name_list; *cursymbol; cursymbol++ )
+void print_cached_symbols( const SYM_CACHE *cache )
+{
+uint32_t entry;
+size_t len;
+char *cursymbol;
+int dri_names = (cache->hdr->flags & SYM_CACHE_DRI_NAMES) != 0;
+
+	for (cursymbol = next_symbol_name(); cursymbol; cursymbol = next_symbol_name())
 	{
-		for( sym = 0; sym < coff_header.num_symbols; sym++ )
+		len = strlen(cursymbol);
+		if (dri_names && len > 8)
+			len = 8;
+
+		entry = sym_cache_find(cache, cursymbol, len);
+		if (entry == SYM_NONE)
+			print_not_found(cursymbol);
+
+		/* DRI prints every symbol with the name, COFF just the first */
+		for ( ; entry != SYM_NONE;
+		      entry = dri_names ? sym_cache_next(cache, entry) : SYM_NONE)
 		{
-			long offset, value;
-			int type, other, description, show_it;
-	
-			offset = coff_symbols[sym].name_offset - 4;	/* Adjust offset by -4 as mentioned earlier... */
-			value = coff_symbols[sym].value;
-			type = (int)coff_symbols[sym].type;
-			other = (int)coff_symbols[sym].other;
-			description = (int)coff_symbols[sym].description;
-
-			if (!coff_symbol_name_compare(&coff_symbols[sym], *cursymbol)) {
-				printf(fmt_string, value);
-				printf("\n");
-				skipped = 0;
-				break;
-			}
+			print_value( (long)cache->entries[entry].value );
 		}
-		if (skipped) {
-			printf("%s: symbol not found\n", *cursymbol);
-		}
-	}	
-
-	farfree( coff_symbols );
-	farfree( coff_symbol_name_strings );
+	}
 }
 
 /**************************************************************************/
@@ -501,7 +586,15 @@ void usage(void)
 {
 	printf( "SYMVAL: Version %d.%02d\n\n", MAJOR_VERSION, MINOR_VERSION );
 
-	printf( "Usage:\n\tSYMVAL [-f fmtstring] filename symbol\n\n");
+	printf( "Usage:\n\tSYMVAL [-c] [-f fmtstring] [-P<n>] filename symbol...\n");
+	printf( "\tSYMVAL [-c] [-f fmtstring] [-P<n>] filename... -- symbol...\n\n");
+	printf( "\tfilename = the file to search, or \"-\" to read it from stdin\n\n" );
+	printf( "\tsymbol = a symbol name, \"-@ listfile\" to read names from\n" );
+	printf( "\t         listfile (one per line), or \"-\" to read them from stdin\n\n" );
+	printf( "\t-c = Keep an index of the symbols in <filename>.symidx and use it\n" );
+	printf( "\t     for lookups while it's up to date\n\n" );
+	printf( "\t-P<n> = Search <n> of the files at once (default: one per\n" );
+	printf( "\t     processor).  The output comes out in the order they're given.\n\n" );
 	exit(2);
 }
 
@@ -509,72 +602,122 @@ void usage(void)
 /**************************************************************************/
 /**************************************************************************/
 
+/* Open <filename> (trying .cof then .abs after it, if it has no */
+/* extension) and look up the symbols in it. */
+
+static int symval_file( char *filename )
+{
+OBJ_FILE obj;
+SYM_CACHE cache;
+char cachename[264];
+int err;
+
+	if( file_count > 1 )
+	  printf( "%s:\n", filename );
+	next_name = symbol_name_list;
+
+	if( ( err = obj_open( &obj, filename ) ) < 0 )
+	{
+		obj_perror( ( err == OBJ_WRONG_TYPE ) ? stderr : stdout, &obj, err, filename );
+		return ( err == OBJ_CANT_READ ) ? -1 : 1;
+	}
+
+	if( use_cache )
+	{
+		cache_name( cachename, &obj );
+		if( sym_cache_open( &cache, cachename, &obj.in, obj_symbol_offset( &obj ) ) == 0 )
+		{
+			print_cached_symbols( &cache );
+			sym_cache_close( &cache );
+			obj_close( &obj );
+			return(0);
+		}
+	}
+
+	err = process_abs_file( &obj );
+	obj_close( &obj );
+	return(err);
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
 void main( int argc, char *argv[] )
 {
-int in_handle;
-short has_period;
-char infile[256], *ptr, *filename;
-int argument;
+char **files, **arg;
+int jobs = 0, file;
 
 	argv++;			/* skip the program name */
 
-	if (*argv && !strcmp(*argv, "-f")) {
-		argv++;
-		fmt_string = *argv;
-		argv++;
-		if (!fmt_string)
+	while (*argv && (*argv)[0] == '-' && (*argv)[1]) {
+		if (!strcmp(*argv, "-f")) {
+			argv++;
+			fmt_string = *argv;
+			argv++;
+			if (!fmt_string)
+				usage();
+		} else if (!strcmp(*argv, "-c")) {
+			use_cache = 1;
+			argv++;
+		} else if (!strncmp(*argv, "-P", 2)) {
+			jobs = atoi(*argv + 2);
+			if (jobs < 1 || jobs > BATCH_MAX_JOBS)
+				usage();
+			argv++;
+		} else {
 			usage();
+		}
 	}
 
 	if (!argv[0] || !argv[1])
 		usage();
 
-/* If you don't sort by name (sort by value), then don't skip duplicate symbols. */
-
-	filename = argv[0];
-	argv ++;
-	symbol_name_list = argv;
+	find_value_digits( fmt_string );
 
-/*	Look for FILENAME.EXT (exactly as given on commandline), if that's
-	not found, and filename specified has no extension, then look
-	for FILENAME.COF, and FILENAME.ABS, and do it in that order. */
+/* The file names run up to a "--", if there is one, otherwise there's */
+/* just the one before the symbols. */
 
-	strncpy( infile, filename, 255 );
-	has_period = (strchr(infile,'.') != NULL) ? 1 : 0;
+	files = argv;
+	for (arg = argv; *arg && strcmp(*arg, "--"); arg++)
+		;
+	if (*arg) {
+		*arg = NULL;
+		file_count = (int)(arg - files);
+		argv = arg + 1;
+		if (!file_count || !*argv)
+			usage();
+	} else {
+		file_count = 1;
+		argv++;
+	}
 
-	in_handle = Fopen( infile, FO_BINARY );
-	if( in_handle < 0 )
+	for (arg = argv; *arg; arg++)
 	{
-		/* If there's an extension specified in the input filename, */
-		/* then show the FILE NOT FOUND error message and exit. */
-
-		if( has_period )
+		if (!strcmp(*arg, "-@"))
 		{
-			printf( "Input file '%s' not found!\n", filename );
-			exit(1);
+			if (!*++arg)
+				usage();
 		}
-
-		/* No filename extension was originally specified, so let's try .COF first. */
-
-		strcat(infile,".cof");
-
-		in_handle = Fopen( infile, FO_BINARY );
-		if( in_handle < 0 )
+		else if (!strcmp(*arg, "-"))
 		{
-			/* file.COF not found, so try .ABS extension */
-
-			if((ptr = strchr(infile,'.')) != NULL)
-			  *ptr=0;
-			strcat(infile,".abs");
-
-			if((in_handle = Fopen( infile, FO_BINARY )) < 0)
+			for (file = 0; file < file_count; file++)
 			{
-				printf("Error: Can't open inputfile: %s\n",filename);
-				exit(1);
+				if (!strcmp(files[file], "-"))
+				{
+					printf("Can't read both the executable and symbol names from stdin\n");
+					exit(-1);
+				}
 			}
 		}
 	}
-	process_abs_file(infile, in_handle);
-	Fclose(in_handle);
-	exit(0);
+
+	read_symbol_names( argv );
+
+	if( file_count == 1 )
+	  exit( symval_file( files[0] ) );
+
+	if( ! jobs )
+	  jobs = batch_jobs_default();
+	exit( batch_run( file_count, files, jobs, symval_file ) ? 1 : 0 );
 }
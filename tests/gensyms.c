@@ -0,0 +1,282 @@
+/*
+	gensyms.c
+
+	Writes made up DRI and BSD/COFF files with as many symbols as are
+	asked for, for "make check".  The same arguments always give the
+	same file, byte for byte, so what the tools print for them can be
+	checked against a known answer without checking in megabytes of
+	test files.
+
+	The names are picked so that sorting them has some work to do:
+	about one in ten is a repeat of an earlier one (for COFF, half of
+	those point at the same string and half at a copy of it), and
+	COFF names often share long prefixes, so that the first 8 bytes
+	don't settle the order.  With -8, DRI names can have bytes with
+	the top bit set, which sort differently as signed chars.
+*/
+
+#include "size.h"
+#include "proto.h"
+
+#define TEXT_SIZE	(1000)
+#define DATA_SIZE	(200)
+#define BSS_SIZE	(300)
+#define TEXT_BASE	(0x802000L)
+
+static uint32_t seed_state;
+static int high_bit = 0;			/* -8 */
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* A xorshift generator, so the files don't depend on the C library. */
+
+static uint32_t rnd( uint32_t range )
+{
+	seed_state ^= seed_state << 13;
+	seed_state ^= seed_state >> 17;
+	seed_state ^= seed_state << 5;
+	return seed_state % range;
+}
+
+static uint32_t rnd_value( void )
+{
+	if( rnd( 10 ) == 0 )
+	  return TEXT_BASE + rnd( 4 ) * 0x10;
+	return rnd( 0x1000000 );
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Fill in <count> 14 byte DRI symbols at <buf>. */
+
+static void make_dri_symbols( uint8_t *buf, uint32_t count )
+{
+static const char chars[] = "abcdefgh_XYZ0123";
+static const uint16_t types[] = { 0xa200, 0xa400, 0xa100, 0xc000, 0x8200, 0x8400, 0xa800, 0xe000 };
+uint32_t sym, len, i;
+uint8_t *rec;
+
+	for( sym = 0, rec = buf; sym < count; sym++, rec += 14 )
+	{
+		memset( rec, 0, 8 );
+		if( sym && rnd( 10 ) == 0 )
+		  memcpy( rec, buf + rnd( sym ) * 14, 8 );
+		else
+		{
+			len = 1 + rnd( 8 );
+			for( i = 0; i < len; i++ )
+			  rec[i] = ( high_bit && rnd( 8 ) == 0 ) ? (uint8_t)( 0x80 + rnd( 0x80 ) )
+								 : (uint8_t)chars[rnd( sizeof(chars) - 1 )];
+		}
+		putshort( rec + 8, types[rnd( sizeof(types) / sizeof(types[0]) )] );
+		putlong( rec + 10, rnd_value() );
+	}
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* Fill in <count> 12 byte BSD symbols at <buf>, and their string table */
+/* at <strings>, which has room for 64 bytes a symbol and its size. */
+/* Returns the size of the string table. */
+
+static uint32_t make_bsd_symbols( uint8_t *buf, uint32_t count, uint8_t *strings )
+{
+static const char *prefixes[] = { "_", "_ZN7Foo", "_ZN7FooBar3Baz", "__gnu_cxx_", "_verylongprefix_" };
+static const uint8_t types[] = { 0x05, 0x04, 0x07, 0x06, 0x09, 0x08, 0x24, 0x20,
+				 0x01, 0x64, 0x84, 0x44, 0x4c, 0x48, 0x80, 0xe0 };
+uint32_t sym, size = 4, len, i, other;
+uint8_t *rec, type;
+char *name;
+
+	for( sym = 0, rec = buf; sym < count; sym++, rec += 12 )
+	{
+		type = types[rnd( sizeof(types) )];
+
+		if( sym && rnd( 10 ) == 0 )
+		{
+			other = rnd( sym );
+			if( rnd( 2 ) )
+			  putlong( rec, getlong( buf + other * 12 ) );
+			else
+			{
+				name = (char *)strings + getlong( buf + other * 12 );
+				len = (uint32_t)strlen( name ) + 1;
+				memmove( strings + size, name, len );
+				putlong( rec, size );
+				size += len;
+			}
+		}
+		else
+		{
+			name = (char *)strings + size;
+			if( type == 0x64 || type == 0x84 )
+			  sprintf( name, "/src/dir%u/file%u.c", (unsigned)rnd( 50 ), (unsigned)rnd( 100 ) );
+			else if( type == 0x80 )
+			  sprintf( name, "v%u:t%u", (unsigned)rnd( 1000 ), (unsigned)rnd( 20 ) );
+			else
+			{
+				strcpy( name, prefixes[rnd( sizeof(prefixes) / sizeof(prefixes[0]) )] );
+				len = (uint32_t)strlen( name ) + rnd( 12 );
+				for( i = (uint32_t)strlen( name ); i < len; i++ )
+				  name[i] = "abcxyz_01"[rnd( 9 )];
+				name[len] = 0;
+			}
+			putlong( rec, size );
+			size += (uint32_t)strlen( name ) + 1;
+		}
+
+		rec[4] = type;
+		rec[5] = 0;
+		putshort( rec + 6, (uint16_t)rnd( 0x10000 ) );
+		putlong( rec + 8, rnd_value() );
+	}
+
+	putlong( strings, size );
+	return size;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* A COFF section header. */
+
+static uint8_t *put_section( uint8_t *ptr, const char *name, uint32_t addr, uint32_t size,
+			     uint32_t offset, uint32_t flags )
+{
+	memset( ptr, 0, 40 );
+	memcpy( ptr, name, strlen( name ) );
+	putlong( ptr + 8, addr );
+	putlong( ptr + 12, addr );
+	putlong( ptr + 16, size );
+	putlong( ptr + 20, offset );
+	putlong( ptr + 36, flags );
+	return ptr + 40;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+void usage( void )
+{
+	printf( "Usage: gensyms [-8] abs|obj|cof|bsd count seed filename\n" );
+	exit(-1);
+}
+
+void main( int argc, char *argv[] )
+{
+const char *kind;
+uint8_t *buf, *ptr, *syms, *strings;
+uint32_t count, hdr_size, sym_size, str_size = 0;
+size_t total;
+int out_handle, dri;
+
+	if( argc > 1 && !strcmp( argv[1], "-8" ) )
+	{
+		high_bit = 1;
+		argc--;
+		argv++;
+	}
+	if( argc != 5 )
+	  usage();
+
+	kind = argv[1];
+	count = (uint32_t)strtoul( argv[2], NULL, 0 );
+	seed_state = (uint32_t)strtoul( argv[3], NULL, 0 ) * 2654435761UL + 1;
+
+	dri = !strcmp( kind, "abs" ) || !strcmp( kind, "obj" );
+	if( !strcmp( kind, "abs" ) )
+	  hdr_size = 36;
+	else if( !strcmp( kind, "obj" ) )
+	  hdr_size = 28;
+	else if( !strcmp( kind, "cof" ) )
+	  hdr_size = 20 + 28 + 3 * 40;
+	else if( !strcmp( kind, "bsd" ) )
+	  hdr_size = 32;
+	else
+	  usage();
+
+	sym_size = count * ( dri ? 14 : 12 );
+	total = hdr_size + TEXT_SIZE + DATA_SIZE + sym_size + ( dri ? 0 : 4 + (size_t)count * 64 );
+	if( ( buf = calloc( total, 1 ) ) == NULL )
+	{
+		printf( "Cannot allocate memory for the file!\n" );
+		exit(-1);
+	}
+
+	for( ptr = buf + hdr_size; ptr < buf + hdr_size + TEXT_SIZE + DATA_SIZE; ptr++ )
+	  *ptr = (uint8_t)rnd( 256 );
+
+	syms = buf + hdr_size + TEXT_SIZE + DATA_SIZE;
+	strings = syms + sym_size;
+	if( dri )
+	  make_dri_symbols( syms, count );
+	else
+	  str_size = make_bsd_symbols( syms, count, strings );
+
+	if( !strcmp( kind, "abs" ) )
+	{
+		putshort( buf, 0x601b );
+		putlong( buf + 2, TEXT_SIZE );
+		putlong( buf + 6, DATA_SIZE );
+		putlong( buf + 10, BSS_SIZE );
+		putlong( buf + 14, sym_size );
+		putlong( buf + 22, TEXT_BASE );
+		putlong( buf + 28, TEXT_BASE + TEXT_SIZE );
+		putlong( buf + 32, TEXT_BASE + TEXT_SIZE + DATA_SIZE );
+	}
+	else if( !strcmp( kind, "obj" ) )
+	{
+		putshort( buf, 0x601a );
+		putlong( buf + 2, TEXT_SIZE );
+		putlong( buf + 6, DATA_SIZE );
+		putlong( buf + 10, BSS_SIZE );
+		putlong( buf + 14, sym_size );
+	}
+	else if( !strcmp( kind, "cof" ) )
+	{
+		putshort( buf, 0x0150 );
+		putshort( buf + 2, 3 );
+		putlong( buf + 8, hdr_size + TEXT_SIZE + DATA_SIZE );
+		putlong( buf + 12, count );
+		putshort( buf + 16, 28 );
+
+		putlong( buf + 20, 0x107 );
+		putlong( buf + 24, TEXT_SIZE );
+		putlong( buf + 28, DATA_SIZE );
+		putlong( buf + 32, BSS_SIZE );
+		putlong( buf + 36, TEXT_BASE );
+		putlong( buf + 40, TEXT_BASE );
+		putlong( buf + 44, TEXT_BASE + TEXT_SIZE );
+
+		ptr = put_section( buf + 48, ".text", TEXT_BASE, TEXT_SIZE, hdr_size, 0x20 );
+		ptr = put_section( ptr, ".data", TEXT_BASE + TEXT_SIZE, DATA_SIZE, hdr_size + TEXT_SIZE, 0x40 );
+		put_section( ptr, ".bss", TEXT_BASE + TEXT_SIZE + DATA_SIZE, BSS_SIZE, 0, 0x80 );
+	}
+	else
+	{
+		putlong( buf, 0x107 );
+		putlong( buf + 4, TEXT_SIZE );
+		putlong( buf + 8, DATA_SIZE );
+		putlong( buf + 12, BSS_SIZE );
+		putlong( buf + 16, sym_size );
+	}
+
+	total = hdr_size + TEXT_SIZE + DATA_SIZE + sym_size + str_size;
+	out_handle = Fopen( argv[4], FO_WRONLY | FO_CREATE | FO_BINARY );
+	if( out_handle < 0 || Fwrite( out_handle, total, buf ) != (long)total )
+	{
+		printf( "Can't write %s\n", argv[4] );
+		exit(-1);
+	}
+	Fclose( out_handle );
+	free( buf );
+	exit(0);
+}
@@ -0,0 +1,311 @@
+#!/bin/sh
+#
+#	tests/run.sh
+#
+#	Run by "make check" from the top of the tree, after the tools and
+#	tests/gensyms have been built.  Each check runs a tool in
+#	tests/work and compares what it printed, and its exit status, with
+#	the file of the same name in tests/expected.  Binary output is
+#	compared by its cksum.  Checks made with check_same compare two
+#	ways of getting the same answer with each other instead.
+#
+#	The small files in tests/fixtures are checked in (they were made
+#	with "gensyms abs 60 1", "obj 40 2", "cof 80 3" and "bsd 50 4",
+#	as small.abs, obj.o, small.cof and bsd.o).  The big ones,
+#	with enough symbols for the sorts to go parallel, are made by
+#	gensyms every time, and come out the same every time.
+#
+#	UPDATE=1 sh tests/run.sh writes the expected files instead of
+#	checking them.
+
+TOP=`pwd`
+TESTS=$TOP/tests
+WORK=$TESTS/work
+EXPECTED=$TESTS/expected
+SIZE=$TOP/size
+ALLSYMS=$TOP/allsyms
+SYMVAL=$TOP/symval
+ADDR2SYM=$TOP/addr2sym
+FILEFIX=$TOP/filefix
+GENSYMS=$TESTS/gensyms
+
+passed=0
+failed=0
+
+rm -rf "$WORK"
+mkdir -p "$WORK" || exit 1
+cp "$TESTS"/fixtures/* "$WORK" || exit 1
+cd "$WORK" || exit 1
+
+# check <name> <command>...
+# Run the command, and compare its output and status with the expected.
+
+check()
+{
+	name=$1
+	shift
+	"$@" > "$name.out" 2>&1
+	echo "exit $?" >> "$name.out"
+	compare "$name"
+}
+
+# check_sum <name> <command>...
+# The same, but for output that's binary, or too big to keep.
+
+check_sum()
+{
+	name=$1
+	shift
+	"$@" > "$name.bin" 2> "$name.err"
+	status=$?
+	{ cksum < "$name.bin"; cat "$name.err"; echo "exit $status"; } > "$name.out"
+	compare "$name"
+}
+
+# check_file <name> <file>...
+# Compare the cksum of files a command has written.
+
+check_file()
+{
+	name=$1
+	shift
+	for file in "$@"
+	do
+		if [ -f "$file" ]
+		then
+			echo "$file `cksum < "$file"`"
+		else
+			echo "$file missing"
+		fi
+	done > "$name.out"
+	compare "$name"
+}
+
+compare()
+{
+	if [ -n "$UPDATE" ]
+	then
+		cp "$1.out" "$EXPECTED/$1"
+	elif cmp -s "$1.out" "$EXPECTED/$1"
+	then
+		passed=`expr $passed + 1`
+	else
+		echo "FAIL: $1"
+		diff "$EXPECTED/$1" "$1.out" | head -20
+		failed=`expr $failed + 1`
+	fi
+}
+
+# check_same <name> <command> <command>
+# Two shell commands that should print exactly the same thing.
+
+check_same()
+{
+	sh -c "$2" > "$1.a" 2>&1
+	sh -c "$3" > "$1.b" 2>&1
+	if cmp -s "$1.a" "$1.b"
+	then
+		passed=`expr $passed + 1`
+	else
+		echo "FAIL: $1"
+		diff "$1.a" "$1.b" | head -20
+		failed=`expr $failed + 1`
+	fi
+}
+
+# Clear res1 in a DRI header, which takes the sorted mark off a .sym file.
+
+unmark()
+{
+	cp "$1" "$2"
+	printf '\000\000\000\000' | dd of="$2" bs=1 seek=18 conv=notrunc 2> /dev/null
+}
+
+# Every name in a file, in file order.
+
+names()
+{
+	"$SIZE" -sd -v0 --format=csv "$1" | sed -e 1d -e 's/,[^,]*,[^,]*$//'
+}
+
+#
+# The listings of the checked-in files.
+#
+
+for file in small.abs obj.o small.cof bsd.o
+do
+	t=`echo $file | tr . _`
+	check size_$t "$SIZE" "$file"
+	check size_s_$t "$SIZE" -s "$file"
+	check size_sd_$t "$SIZE" -sd "$file"
+	check size_v0_$t "$SIZE" -s -v0 "$file"
+	check size_v2_$t "$SIZE" -s -v2 "$file"
+	check size_l_$t "$SIZE" -s -l "$file"
+	check size_u_$t "$SIZE" -u "$file"
+	check size_jsonl_$t "$SIZE" --format=jsonl "$file"
+	check size_csv_$t "$SIZE" --format=csv -v2 "$file"
+	check_sum size_bin_$t "$SIZE" --format=bin "$file"
+	check allsyms_$t "$ALLSYMS" "$file"
+	check allsyms_csv_$t "$ALLSYMS" --format=csv "$file"
+done
+
+# The same files read from a pipe.
+
+check_same size_stdin "'$SIZE' -s small.cof" "cat small.cof | '$SIZE' -s -"
+check_same allsyms_stdin "'$ALLSYMS' obj.o" "cat obj.o | '$ALLSYMS' -"
+
+#
+# symval: the first symbol in file order with the name wins, stabs
+# included, whether the table is loaded, scanned or cached.
+#
+
+names small.cof | head -40 > cof_names
+names small.abs > abs_names
+check symval_cof_few "$SYMVAL" small.cof `sed -n -e 1p -e 7p -e 30p cof_names`
+check symval_fmt "$SYMVAL" -f '%08lx' small.cof `sed -n 3p cof_names`
+check_same symval_stdin "'$SYMVAL' small.cof `sed -n 3p cof_names`" \
+	"cat small.cof | '$SYMVAL' - `sed -n 3p cof_names`"
+check symval_cof "$SYMVAL" small.cof -@ cof_names nosuchsymbol
+check symval_abs "$SYMVAL" small.abs -@ abs_names
+check_same symval_names_stdin "'$SYMVAL' small.cof -@ cof_names" "'$SYMVAL' small.cof - < cof_names"
+check symval_cof_c1 "$SYMVAL" -c small.cof -@ cof_names
+check symval_cof_c2 "$SYMVAL" -c small.cof -@ cof_names
+check_same symval_cof_cached "'$SYMVAL' small.cof -@ cof_names" "'$SYMVAL' -c small.cof -@ cof_names"
+check_same symval_abs_cached "'$SYMVAL' small.abs -@ abs_names" "'$SYMVAL' -c small.abs -@ abs_names"
+
+#
+# filefix, and the sorted .sym files it writes.
+#
+
+cp small.abs ff_abs.abs
+cp small.cof ff_cof.cof
+check filefix_abs "$FILEFIX" ff_abs
+check filefix_cof "$FILEFIX" ff_cof
+check_file filefix_files ff_abs.tx ff_abs.dta ff_abs.db ff_cof.tx ff_cof.dta ff_cof.db
+check filefix_rom "$FILEFIX" -q -rs rom.bin -p -z ff_abs
+check_file filefix_rom_files rom.bin rom.db
+check_file filefix_sym ff_abs.sym
+
+unmark ff_abs.sym unsorted.sym
+names ff_abs.sym > sym_names
+check symval_sym "$SYMVAL" ff_abs.sym -@ sym_names nosuchsym
+check_same symval_sym_unmarked "'$SYMVAL' ff_abs.sym -@ sym_names" "'$SYMVAL' unsorted.sym -@ sym_names"
+check_same size_sym_unmarked "'$SIZE' -s ff_abs.sym" "'$SIZE' -s unsorted.sym"
+
+#
+# addr2sym
+#
+
+check addr2sym_abs "$ADDR2SYM" small.abs 802000 0x802010 '$8023e8' 0 ffffff
+check addr2sym_cof "$ADDR2SYM" small.cof 802000 0x802004 '$8024b0' 10
+printf 'pc=00802004 sp=$00f00000 d0=0x802011 facade 1234\n' > trace
+check addr2sym_trace sh -c "'$ADDR2SYM' -t small.abs < trace"
+"$GENSYMS" abs 0 1 nosyms.abs
+check addr2sym_nosyms sh -c "'$ADDR2SYM' -t nosyms.abs < trace"
+
+#
+# Big tables: the radix sort, the parallel sort and duplicate marking,
+# and the address index, which all only kick in past 65536 symbols.
+#
+
+"$GENSYMS" abs 100000 7 big.abs
+"$GENSYMS" -8 abs 100000 8 hibit.abs
+"$GENSYMS" cof 100000 9 big.cof
+"$GENSYMS" bsd 70000 10 big.o
+
+# DRI names are sorted the way the C compiler's chars compare, so the
+# order of names with the top bit set depends on the machine, and
+# hibit.abs is only checked against itself.
+
+for file in big.abs hibit.abs big.cof big.o
+do
+	t=`echo $file | tr . _`
+	if [ $file != hibit.abs ]
+	then
+		check_sum big_s_$t "$SIZE" -s "$file"
+		check_sum big_v2_$t "$SIZE" -s -v2 "$file"
+		check_sum big_u_$t "$SIZE" -u "$file"
+	fi
+	check_same big_j_$t "'$SIZE' -s -j1 $file" "'$SIZE' -s -j4 $file"
+	check_same big_jsd_$t "'$SIZE' -sd -v2 -j1 $file" "'$SIZE' -sd -v2 -j4 $file"
+	check_same big_ju_$t "'$SIZE' -u -j1 $file" "'$SIZE' -u -j4 $file"
+done
+
+names big.cof | awk 'NR % 997 == 1' > big_names
+check_same big_symval_cached "'$SYMVAL' big.cof -@ big_names" "'$SYMVAL' -c big.cof -@ big_names"
+
+# Give a symbol well past the start of the file a new value, without
+# changing the file's size, and the cached index has to notice by the
+# time stamp.  The file is dated back first, so the rewrite can't land
+# on the same tick.  The symbols start at 1368, and the value is 8
+# bytes in.
+
+names big.cof > all_names
+sym=`awk '{ n[NR] = $0; c[$0]++ } END { for( i = 5000; c[n[i]] != 1; i++ ) ; print i }' all_names`
+cp big.cof changed.cof
+touch -t 200001010000 changed.cof
+"$SYMVAL" -c changed.cof `sed -n ${sym}p all_names` > /dev/null
+printf '\001\002\003\004' | dd of=changed.cof bs=1 seek=`expr 1368 + 12 \* $sym - 4` conv=notrunc 2> /dev/null
+check symval_changed "$SYMVAL" -c changed.cof `sed -n ${sym}p all_names`
+
+# The same with the time stamp put back, but with the symbol count in
+# the header changed, which the index checks the headers for.
+
+cp big.cof recount.cof
+touch -t 200001010000 recount.cof
+"$SYMVAL" -c recount.cof `sed -n ${sym}p all_names` > /dev/null
+printf '\000\000\023\210' | dd of=recount.cof bs=1 seek=12 conv=notrunc 2> /dev/null
+touch -t 200001010000 recount.cof
+check symval_recount "$SYMVAL" -c recount.cof `sed -n ${sym}p all_names`
+check_sum big_symval_cof "$SYMVAL" big.cof -@ big_names
+
+# A few names are looked for in the string table instead of indexing
+# every symbol (as -c does), which has to find the same ones.
+
+few=`sed -n -e 2p -e 50p -e 99p big_names | tr '\n' ' '`
+cp big.cof few.cof
+check big_symval_few "$SYMVAL" big.cof $few
+check_same big_symval_scan "'$SYMVAL' big.cof $few" "'$SYMVAL' -c few.cof $few"
+
+cp big.abs ff_big.abs
+"$FILEFIX" -q ff_big > /dev/null
+check_file filefix_big ff_big.sym
+names big.abs | awk 'NR % 499 == 1' > big_abs_names
+unmark ff_big.sym unsorted_big.sym
+check_sum big_symval_sym "$SYMVAL" ff_big.sym -@ big_abs_names
+check_same big_symval_sym_unmarked "'$SYMVAL' ff_big.sym -@ big_abs_names" \
+	"'$SYMVAL' unsorted_big.sym -@ big_abs_names"
+
+# "SORT" in res1 of a file that isn't just symbols doesn't count.
+
+cp big.abs foreign.abs
+printf 'SORT' | dd of=foreign.abs bs=1 seek=18 conv=notrunc 2> /dev/null
+check_same big_symval_foreign "'$SYMVAL' big.abs -@ big_abs_names" "'$SYMVAL' foreign.abs -@ big_abs_names"
+
+# A DRI name can be on more than one symbol, and symval prints them all,
+# which filefix leaves in value order, without any repeats.
+
+check_same big_symval_abs_sym "'$SYMVAL' big.abs -@ big_abs_names | sort -u" \
+	"'$SYMVAL' ff_big.sym -@ big_abs_names | sort -u"
+
+awk 'BEGIN { for( i = 0; i < 3000; i++ ) printf( "%x\n", 8380000 + i * 37 ) }' > big_addrs
+check_sum big_addr2sym sh -c "'$ADDR2SYM' big.abs - < big_addrs"
+check_same big_addr2sym_trace "'$ADDR2SYM' big.abs - < big_addrs | sed 's/^[^ ]* //'" \
+	"sed 's/^/x /' big_addrs | '$ADDR2SYM' -t big.abs | sed 's/^x //'"
+
+#
+# Several files at once: the output comes out in the order given,
+# however many are worked on at the same time.
+#
+
+check_same batch_size "'$SIZE' -s -P1 small.abs big.cof obj.o hibit.abs bsd.o" \
+	"'$SIZE' -s -P4 small.abs big.cof obj.o hibit.abs bsd.o"
+check_same batch_allsyms "'$ALLSYMS' -P1 big.abs small.cof obj.o" "'$ALLSYMS' -P3 big.abs small.cof obj.o"
+check_same batch_symval "'$SYMVAL' -P1 small.cof big.cof -- -@ cof_names" \
+	"'$SYMVAL' -P4 small.cof big.cof -- -@ cof_names"
+check_same batch_symval_stdin "'$SYMVAL' small.cof big.cof small.abs -- -@ cof_names" \
+	"'$SYMVAL' small.cof big.cof small.abs -- - < cof_names"
+check batch_missing "$SIZE" -P2 small.abs nosuchfile.abs obj.o
+
+echo "$passed passed, $failed failed"
+[ $failed -eq 0 ]